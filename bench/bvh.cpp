@@ -0,0 +1,73 @@
+#include "c++lib.hpp"
+#include "bvh.hpp"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+// edge_bvh on a 50k edge level, a noisy loop spiralling out over a
+// few hundred units, against testing every edge: build time, then
+// random circles that have to hit the same walls both ways
+
+using namespace phobos;
+
+static float distance2(glm::vec2 c, glm::vec2 from, glm::vec2 swept)
+{
+	const auto d = c - from;
+	const float ss = swept.x * swept.x + swept.y * swept.y;
+	const float t = ss > 0.0f? std::clamp((d.x * swept.x + d.y * swept.y) / ss, 0.0f, 1.0f): 0.0f;
+	const auto e = d - swept * t;
+	return e.x * e.x + e.y * e.y;
+}
+
+int main()
+{
+	constexpr std::uint32_t edges = 50000, circles = 2000;
+	std::mt19937 rng(19);
+	std::uniform_real_distribution<float> noise(-0.3f, 0.3f), pos(-120.0f, 120.0f), rad(0.2f, 0.8f);
+
+	std::vector<glm::vec2> loop(edges);
+	for (std::uint32_t i = 0; i < edges; ++i) {
+		const float a = 6.2831853f * 40.0f * i / edges;
+		const float r = 5.0f + 110.0f * i / edges;
+		loop[i] = { r * std::cos(a) + noise(rng), r * std::sin(a) + noise(rng) };
+	}
+	std::vector<glm::vec2> c(circles);
+	std::vector<float> r(circles);
+	for (std::uint32_t i = 0; i < circles; ++i) {
+		c[i] = { pos(rng), pos(rng) };
+		r[i] = rad(rng);
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	edge_bvh bvh;
+	bvh.build(loop);
+	auto t1 = std::chrono::steady_clock::now();
+	const double build_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+	std::vector<std::uint8_t> want(circles), got(circles);
+	t0 = std::chrono::steady_clock::now();
+	for (std::uint32_t i = 0; i < circles; ++i)
+		for (std::uint32_t e = 0; e < edges && !want[i]; ++e)
+			want[i] = distance2(c[i], loop[e], loop[(e+1) % edges] - loop[e]) <= r[i] * r[i];
+	t1 = std::chrono::steady_clock::now();
+	const double brute_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / circles;
+
+	constexpr int rounds = 50;
+	t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < rounds; ++k) {
+		for (std::uint32_t i = 0; i < circles; ++i) {
+			const glm::vec2 half{ r[i], r[i] };
+			got[i] = bvh.query(aabb{ c[i] - half, c[i] + half }, [&] (glm::vec2 from, glm::vec2 swept) {
+				return distance2(c[i], from, swept) <= r[i] * r[i];
+			});
+		}
+	}
+	t1 = std::chrono::steady_clock::now();
+	const double bvh_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds / circles;
+
+	const auto hits = std::ranges::count(got, 1);
+	const bool same = got == want;
+	std::print("[BENCH] bvh {} edges: built in {:.2f} ms, {} of {} circles hit{}, {:.3f} us per circle, brute force {:.1f} us\n",
+			edges, build_ms, hits, circles, same? "": " NOT the brute force set", bvh_us, brute_us);
+	return same? 0: 1;
+}
@@ -0,0 +1,45 @@
+#include "c++lib.hpp"
+#include "system.hpp"
+#include <chrono>
+
+// mass despawn through the real entity and system paths: a wave of
+// 10k entities with a tick timer, half of them listening for it too,
+// all despawned in one tick, then the time update() takes to tear
+// them down
+
+using namespace phobos;
+
+int main()
+{
+	constexpr std::uint32_t wave = 10000;
+	constexpr int rounds = 200;
+	std::vector<entity> es(wave);
+	// std::system is in scope too
+	auto &all = phobos::system;
+
+	std::uint32_t bad = 0;
+	double ns = 0.0;
+	for (int k = 0; k < rounds; ++k) {
+		for (std::uint32_t i = 0; i < wave; ++i) {
+			es[i] = spawn();
+			all.tick.wait(es[i], 1.0f);
+			if (i & 1)
+				all.dispatch_timeout.listen(es[i]);
+		}
+		for (const auto e : es)
+			despawn(e);
+
+		const auto t0 = std::chrono::steady_clock::now();
+		update();
+		const auto t1 = std::chrono::steady_clock::now();
+		ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+		bad += !all.dispatch_timeout.listening_time.empty();
+		for (const auto e : es)
+			bad += alive(e) || has_component(e, system_id::tick) || has_component(e, system_id::dispatch_timeout);
+	}
+
+	std::print("[BENCH] despawn {} entities: {} mismatches, {:.3f} ms per tick, {:.1f} ns per entity\n",
+			wave, bad, ns / rounds / 1e6, ns / rounds / wave);
+	return bad? 1: 0;
+}
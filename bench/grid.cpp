@@ -0,0 +1,74 @@
+#include "c++lib.hpp"
+#include "grid.hpp"
+#include <chrono>
+#include <random>
+
+// grid broadphase over random circle bounds at the density the game
+// runs at, timed per tick and checked against brute force, which
+// also gets timed up to 10k boxes
+
+using namespace phobos;
+
+static double ms_since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static std::uint64_t key(std::uint32_t l, std::uint32_t r)
+{
+	return std::uint64_t{std::min(l, r)} << 32 | std::max(l, r);
+}
+
+int main()
+{
+	std::mt19937 rng(13);
+	std::uniform_real_distribution<float> rad(0.05f, 3.0f);
+
+	int failed = 0;
+	for (const std::uint32_t n : { 100u, 1000u, 10000u, 50000u }) {
+		// about one circle per 16 square units
+		const float side = std::sqrt(static_cast<float>(n)) * 2.0f;
+		std::uniform_real_distribution<float> pos(-side, side);
+		std::vector<aabb> boxes(n);
+		for (auto &b : boxes) {
+			const glm::vec2 c{ pos(rng), pos(rng) };
+			const auto r = rad(rng);
+			b = { c - glm::vec2{ r, r }, c + glm::vec2{ r, r } };
+		}
+
+		grid g;
+		g.cell_size = 2.0f;
+		const int ticks = n <= 1000? 200: 10;
+		std::vector<std::uint64_t> got;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int k = 0; k < ticks; ++k) {
+			got.clear();
+			g.clear();
+			for (std::uint32_t i = 0; i < n; ++i)
+				g.insert(boxes[i], i);
+			g.build();
+			g.pairs([&] (std::uint32_t l, std::uint32_t r) { got.push_back(key(l, r)); });
+		}
+		const double grid_ms = ms_since(t0) / ticks;
+
+		if (n > 10000) {
+			std::print("[BENCH] grid {}: {} pairs, {:.3f} ms per tick\n", n, got.size(), grid_ms);
+			continue;
+		}
+
+		std::vector<std::uint64_t> want;
+		t0 = std::chrono::steady_clock::now();
+		for (std::uint32_t i = 0; i < n; ++i)
+			for (auto j = i+1; j < n; ++j)
+				if (overlap(boxes[i], boxes[j]))
+					want.push_back(key(i, j));
+		const double brute_ms = ms_since(t0);
+
+		std::ranges::sort(got);
+		const bool same = got == want;
+		failed += !same;
+		std::print("[BENCH] grid {}: {} pairs{}, {:.3f} ms per tick, brute force {:.3f} ms\n",
+				n, got.size(), same? "": " NOT the brute force set", grid_ms, brute_ms);
+	}
+	return failed? 1: 0;
+}
@@ -0,0 +1,58 @@
+#include "c++lib.hpp"
+#include "job.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+// parallel_for scaling from one worker to one per core, or to the
+// count given as the first argument, on a loop about as heavy per
+// element as the collider and trail updates, each run checked
+// against the serial result
+
+using namespace phobos;
+
+static float work(std::uint32_t i)
+{
+	float x = static_cast<float>(i);
+	for (int k = 0; k < 4; ++k)
+		x = std::sin(x) * 0.5f + std::cos(x * 0.25f);
+	return x;
+}
+
+int main(int argc, char **argv)
+{
+	constexpr std::uint32_t count = 1 << 18;
+	constexpr int rounds = 10;
+	std::vector<float> want(count), got(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		want[i] = work(i);
+
+	const unsigned cores = argc > 1? std::max(1, std::atoi(argv[1])): std::max(1u, std::thread::hardware_concurrency());
+	double one = 0.0;
+	int failed = 0;
+	for (unsigned n = 1; n <= cores; n = n < cores? std::min(n*2, cores): n+1) {
+		std::ranges::fill(got, 0.0f);
+		jobs pool;
+		pool.worker_count = n;
+		pool.init();
+		const auto t0 = std::chrono::steady_clock::now();
+		for (int k = 0; k < rounds; ++k)
+			pool.parallel_for(0, count, 4096, [&] (std::uint32_t b, std::uint32_t e) {
+				for (auto i = b; i < e; ++i)
+					got[i] = work(i);
+			});
+		const auto t1 = std::chrono::steady_clock::now();
+		const auto workers = pool.size();
+		pool.fini();
+
+		const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / rounds;
+		if (n == 1)
+			one = ms;
+		const bool same = got == want;
+		failed += !same;
+		std::print("[BENCH] jobs {} workers{}: {:.2f} ms per loop, {:.2f}x\n",
+				workers, same? "": " NOT the serial result", ms, one / ms);
+	}
+	return failed? 1: 0;
+}
@@ -0,0 +1,55 @@
+#include "c++lib.hpp"
+#include "system.hpp"
+
+// the default layers and masks through phys::update(): a body, two
+// attacks and two sensors all overlapping, every pair but attack
+// against attack and sensor against sensor has to reach the
+// narrowphase and be reported
+
+using namespace phobos;
+
+int main()
+{
+	// std::system is in scope too
+	auto &all = phobos::system;
+	all.tfms.init();
+	all.phys.init();
+	all.phys.subscribe_all();
+
+	const auto body = spawn();
+	const entity attacks[] = { spawn(), spawn() };
+	const entity sensors[] = { spawn(), spawn() };
+	all.tfms.transformable(body, transform{{ { 1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.5f, 0.5f } }, 0});
+	all.phys.collider_circle(body);
+	for (const auto e : attacks) {
+		all.tfms.transformable(e, transform{{ { 2.0f, 0.0f }, { 0.0f, 2.0f }, { 0.0f, 0.0f } }, 0});
+		all.phys.collider_triangle(e);
+	}
+	for (const auto e : sensors) {
+		all.tfms.transformable(e, transform{{ { 0.0f, 3.0f }, { -3.0f, 0.0f }, { 0.5f, -1.0f } }, 0});
+		all.phys.collider_ray(e);
+	}
+	all.tfms.propagate();
+	all.phys.update(0.0f, 0.0f);
+
+	const auto touching = [&] (entity e, entity other)
+	{
+		const auto rows = all.phys.colliding_by.of(e);
+		return std::ranges::find(rows, other, &phys::collision_data::other) != rows.end();
+	};
+	std::uint32_t bad = 0;
+	for (const auto a : attacks) {
+		bad += !touching(a, body);
+		for (const auto s : sensors)
+			bad += !touching(a, s) || !touching(s, a);
+	}
+	for (const auto s : sensors)
+		bad += !touching(s, body);
+	bad += touching(attacks[0], attacks[1]) || touching(sensors[0], sensors[1]);
+	// the two same-layer pairs are the only ones skipped
+	bad += all.phys.tested != 8 || all.phys.skipped != 2;
+
+	std::print("[BENCH] layers: {} pairs tested, {} skipped, {} reported, {} mismatches\n",
+			all.phys.tested, all.phys.skipped, all.phys.colliding.size() / 2, bad);
+	return bad? 1: 0;
+}
@@ -0,0 +1,167 @@
+#include "c++lib.hpp"
+#include "phys.hpp"
+#include "narrow.hpp"
+#include <bit>
+#include <chrono>
+#include <random>
+
+// every block kernel the cpu runs against the scalar collision_test,
+// lane by lane, on random pairs and on the edge cases where a
+// differently ordered computation would round the other way, then
+// the time per pair of each
+
+using namespace phobos;
+
+static const char *const g_simd_names[] = { "scalar", "sse2", "avx" };
+
+static circle lane(circle_block const &b, std::uint32_t i)
+{
+	return { { b.x[i], b.y[i] }, b.r[i] };
+}
+
+static ray lane(ray_block const &b, std::uint32_t i)
+{
+	return { { b.ox[i], b.oy[i] }, { b.sx[i], b.sy[i] } };
+}
+
+static triangle lane(triangle_block const &b, std::uint32_t i)
+{
+	return { { b.ox[i], b.oy[i] }, { b.ux[i], b.uy[i] }, { b.vx[i], b.vy[i] } };
+}
+
+static void set(circle_block &b, std::uint32_t i, circle const &c)
+{
+	b.x[i] = c.origin.x;
+	b.y[i] = c.origin.y;
+	b.r[i] = c.radius;
+}
+
+static void set(ray_block &b, std::uint32_t i, ray const &r)
+{
+	b.ox[i] = r.origin.x;
+	b.oy[i] = r.origin.y;
+	b.sx[i] = r.swept.x;
+	b.sy[i] = r.swept.y;
+}
+
+static void set(triangle_block &b, std::uint32_t i, triangle const &t)
+{
+	b.ox[i] = t.origin.x;
+	b.oy[i] = t.origin.y;
+	b.ux[i] = t.u.x;
+	b.uy[i] = t.u.y;
+	b.vx[i] = t.v.x;
+	b.vy[i] = t.v.y;
+}
+
+// pairs cut in blocks, the last one possibly partial
+template <typename R>
+struct pairs
+{
+	std::vector<circle_block> l;
+	std::vector<R> r;
+	std::vector<std::uint32_t> n;
+
+	template <typename S>
+	void add(circle const &c, S const &s)
+	{
+		if (n.empty() || n.back() == block_lanes) {
+			// unused lanes hold shapes that would hit, a kernel
+			// has to mask them out
+			l.emplace_back();
+			r.emplace_back();
+			std::fill_n(reinterpret_cast<float*>(&l.back()), sizeof(circle_block) / sizeof(float), 0.5f);
+			std::fill_n(reinterpret_cast<float*>(&r.back()), sizeof(R) / sizeof(float), 0.5f);
+			n.push_back(0);
+		}
+		set(l.back(), n.back(), c);
+		set(r.back(), n.back(), s);
+		++n.back();
+	}
+
+	std::uint32_t mismatches() const
+	{
+		std::uint32_t bad = 0;
+		for (size_t b = 0; b < l.size(); ++b) {
+			std::uint32_t want = 0;
+			for (std::uint32_t i = 0; i < n[b]; ++i)
+				want |= std::uint32_t{collision_test(lane(l[b], i), lane(r[b], i))} << i;
+			bad += std::popcount(test_block(l[b], r[b], n[b]) ^ want);
+		}
+		return bad;
+	}
+
+	double ns_per_pair(int rounds) const
+	{
+		std::uint32_t sink = 0;
+		const auto t0 = std::chrono::steady_clock::now();
+		for (int k = 0; k < rounds; ++k)
+			for (size_t b = 0; b < l.size(); ++b)
+				sink += std::popcount(test_block(l[b], r[b], n[b]));
+		const auto t1 = std::chrono::steady_clock::now();
+		// keeps the loop from being thrown away
+		if (sink == 0xffffffff)
+			std::print("");
+		const double count = static_cast<double>(rounds) * l.size() * std::uint32_t{block_lanes};
+		return std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+	}
+};
+
+int main()
+{
+	std::mt19937 rng(18);
+	std::uniform_real_distribution<float> pos(-4.0f, 4.0f), len(-3.0f, 3.0f), rad(0.0f, 2.0f);
+	const auto any_circle = [&] { return circle{ { pos(rng), pos(rng) }, rad(rng) }; };
+	const auto any_ray = [&] { return ray{ { pos(rng), pos(rng) }, { len(rng), len(rng) } }; };
+	const auto any_triangle = [&] { return triangle{ { pos(rng), pos(rng) }, { len(rng), len(rng) }, { len(rng), len(rng) } }; };
+
+	pairs<circle_block> cc;
+	pairs<ray_block> cr;
+	pairs<triangle_block> ct;
+
+	// edge cases first: exact tangents, zero radii, zero length
+	// segments, degenerate triangles and centers on corners
+	const circle unit{ { 0.0f, 0.0f }, 1.0f };
+	cc.add(unit, circle{ { 2.0f, 0.0f }, 1.0f });
+	cc.add(unit, circle{ { 0.0f, -2.0f }, 1.0f });
+	cc.add(unit, circle{ { 0.0f, 0.0f }, 0.0f });
+	cc.add(circle{ { 1.0f, 1.0f }, 0.0f }, circle{ { 1.0f, 1.0f }, 0.0f });
+	cc.add(circle{ { 0.1f, 0.2f }, 0.3f }, circle{ { 0.4f, 0.6f }, 0.2f });
+	cr.add(unit, ray{ { -1.0f, 1.0f }, { 2.0f, 0.0f } });
+	cr.add(unit, ray{ { 1.0f, 0.0f }, { 0.0f, 0.0f } });
+	cr.add(unit, ray{ { 2.0f, 0.0f }, { 0.0f, 0.0f } });
+	cr.add(unit, ray{ { 0.0f, 2.0f }, { 0.0f, -1.0f } });
+	cr.add(circle{ { 0.0f, 0.0f }, 0.0f }, ray{ { -1.0f, 0.0f }, { 2.0f, 0.0f } });
+	cr.add(circle{ { 0.3f, 0.1f }, 0.2f }, ray{ { 0.1f, 0.3f }, { 0.0f, 0.0f } });
+	ct.add(unit, triangle{ { 1.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } });
+	ct.add(unit, triangle{ { 2.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f } });
+	ct.add(unit, triangle{ { -1.0f, 1.0f }, { 2.0f, 0.0f }, { 2.0f, 0.0f } });
+	ct.add(circle{ { 0.0f, 0.0f }, 0.0f }, triangle{ { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } });
+	ct.add(circle{ { 0.25f, 0.25f }, 0.0f }, triangle{ { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } });
+	ct.add(circle{ { 0.25f, 0.25f }, 0.0f }, triangle{ { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f } });
+	// then enough random ones to hit about half the time
+	for (int i = 0; i < 200000; ++i) {
+		cc.add(any_circle(), any_circle());
+		cr.add(any_circle(), any_ray());
+		ct.add(any_circle(), any_triangle());
+	}
+	// and a partial block at the end
+	cc.add(any_circle(), any_circle());
+	cr.add(any_circle(), any_ray());
+	ct.add(any_circle(), any_triangle());
+
+	int failed = 0;
+	for (const auto level : { simd::scalar, simd::sse2, simd::avx }) {
+		if (select_block_kernels(level) != level) {
+			std::print("[BENCH] narrow {}: not supported here\n", g_simd_names[static_cast<int>(level)]);
+			continue;
+		}
+		const auto bad_cc = cc.mismatches(), bad_cr = cr.mismatches(), bad_ct = ct.mismatches();
+		failed += bad_cc + bad_cr + bad_ct;
+		std::print("[BENCH] narrow {}: {} {} {} mismatches, circle {:.2f} ray {:.2f} triangle {:.2f} ns per pair\n",
+				g_simd_names[static_cast<int>(level)], bad_cc, bad_cr, bad_ct,
+				cc.ns_per_pair(20), cr.ns_per_pair(20), ct.ns_per_pair(20));
+	}
+	select_block_kernels();
+	return failed? 1: 0;
+}
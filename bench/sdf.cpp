@@ -0,0 +1,113 @@
+#include "c++lib.hpp"
+#include "sdf.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+// distance_field on the level of bench/bvh at two cell sizes: bake
+// time, error against the exact distance, then random circles
+// settled the way phys::hits_wall does, which has to give the same
+// hits as the edge bvh alone. with PHOBOS_SDF_CACHE set the bake
+// goes through the cache and is timed a second time from it
+
+using namespace phobos;
+
+static double ms_since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static float distance2(glm::vec2 c, glm::vec2 from, glm::vec2 swept)
+{
+	const auto d = c - from;
+	const float ss = swept.x * swept.x + swept.y * swept.y;
+	const float t = ss > 0.0f? std::clamp((d.x * swept.x + d.y * swept.y) / ss, 0.0f, 1.0f): 0.0f;
+	const auto e = d - swept * t;
+	return e.x * e.x + e.y * e.y;
+}
+
+int main()
+{
+	constexpr std::uint32_t edges = 50000, circles = 200000, sampled = 20000;
+	std::mt19937 rng(20);
+	std::uniform_real_distribution<float> noise(-0.3f, 0.3f), pos(-110.0f, 110.0f), rad(0.2f, 0.8f);
+
+	std::vector<glm::vec2> loop(edges);
+	for (std::uint32_t i = 0; i < edges; ++i) {
+		const float a = 6.2831853f * 40.0f * i / edges;
+		const float r = 5.0f + 110.0f * i / edges;
+		loop[i] = { r * std::cos(a) + noise(rng), r * std::sin(a) + noise(rng) };
+	}
+	std::vector<glm::vec2> c(circles);
+	std::vector<float> r(circles);
+	for (std::uint32_t i = 0; i < circles; ++i) {
+		c[i] = { pos(rng), pos(rng) };
+		r[i] = rad(rng);
+	}
+	edge_bvh bvh;
+	bvh.build(loop);
+	const auto exact = [&] (std::uint32_t i)
+	{
+		const glm::vec2 half{ r[i], r[i] };
+		return bvh.query(aabb{ c[i] - half, c[i] + half }, [&] (glm::vec2 from, glm::vec2 swept) {
+			return distance2(c[i], from, swept) <= r[i] * r[i];
+		});
+	};
+
+	std::vector<std::uint8_t> want(circles), got(circles);
+	auto t0 = std::chrono::steady_clock::now();
+	for (std::uint32_t i = 0; i < circles; ++i)
+		want[i] = exact(i);
+	const double bvh_ns = ms_since(t0) * 1e6 / circles;
+
+	const auto env = std::getenv("PHOBOS_SDF_CACHE");
+	const std::string_view cache = env? env: "";
+	int failed = 0;
+	for (const float cell : { 0.5f, 0.25f }) {
+		distance_field sdf;
+		t0 = std::chrono::steady_clock::now();
+		sdf.bake(bvh, loop, cell, 1.0f, cache);
+		const double bake_ms = ms_since(t0);
+		double cached_ms = 0.0;
+		if (!cache.empty()) {
+			distance_field again;
+			t0 = std::chrono::steady_clock::now();
+			again.bake(bvh, loop, cell, 1.0f, cache);
+			cached_ms = ms_since(t0);
+		}
+
+		double sum = 0.0, worst = 0.0;
+		for (std::uint32_t i = 0; i < sampled; ++i) {
+			const double err = std::abs(std::abs(sdf.distance(c[i])) - std::sqrt(bvh.nearest2(c[i])));
+			sum += err;
+			worst = std::max(worst, err);
+		}
+
+		std::uint32_t fallbacks = 0;
+		t0 = std::chrono::steady_clock::now();
+		for (std::uint32_t i = 0; i < circles; ++i) {
+			const auto d = std::abs(sdf.distance(c[i]));
+			if (d > r[i] + sdf.slack()) {
+				got[i] = false;
+			} else if (d < r[i] - sdf.slack()) {
+				got[i] = true;
+			} else {
+				++fallbacks;
+				got[i] = exact(i);
+			}
+		}
+		const double sdf_ns = ms_since(t0) * 1e6 / circles;
+
+		const bool same = got == want;
+		failed += !same;
+		std::print("[BENCH] sdf cell {}: baked in {:.0f} ms, error mean {:.4f} max {:.4f} (slack {:.4f})\n",
+				cell, bake_ms, sum / sampled, worst, sdf.slack());
+		if (!cache.empty())
+			std::print("[BENCH] sdf cell {}: {:.1f} ms from cache\n", cell, cached_ms);
+		std::print("[BENCH] sdf cell {}: {} hits{}, {:.1f}% fallbacks, {:.0f} ns per circle, bvh alone {:.0f} ns\n",
+				cell, std::ranges::count(got, 1), same? "": " NOT the exact set",
+				100.0 * fallbacks / circles, sdf_ns, bvh_ns);
+	}
+	return failed? 1: 0;
+}
@@ -0,0 +1,110 @@
+#include "c++lib.hpp"
+#include "sparse.hpp"
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+
+// sparse_index against the std::unordered_map it replaced at 1k,
+// 100k and 1M live keys: insert, lookup and erase cost each, in
+// random order, on a key space twice as wide like recycled indices.
+// a random insert/erase workload is kept in step with the map first
+
+using namespace phobos;
+
+template <typename F>
+static double ns_per(std::uint64_t count, F &&fn)
+{
+	const auto t0 = std::chrono::steady_clock::now();
+	const auto sink = fn();
+	const auto t1 = std::chrono::steady_clock::now();
+	// keeps the loop from being thrown away
+	if (sink == 0xffffffff)
+		std::print("");
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+}
+
+static std::uint32_t mismatches(std::mt19937 &rng)
+{
+	sparse_index s;
+	std::unordered_map<std::uint32_t, std::uint32_t> m;
+	std::uint32_t bad = 0;
+	for (std::uint32_t i = 0; i < 1000000; ++i) {
+		const auto k = rng() % 100000;
+		if (const auto it = m.find(k); it != m.end()) {
+			bad += !s.contains(k) || s.at(k) != it->second;
+			s.erase(k);
+			m.erase(it);
+		} else {
+			bad += s.contains(k);
+			s.insert(k, i);
+			m.emplace(k, i);
+		}
+	}
+	bad += s.size() != m.size();
+	for (const auto &[k, v] : m)
+		bad += !s.contains(k) || s.at(k) != v;
+	return bad;
+}
+
+int main()
+{
+	std::mt19937 rng(1);
+	const auto bad = mismatches(rng);
+	std::print("[BENCH] sparse: {} mismatches against unordered_map\n", bad);
+
+	for (const std::uint32_t n : { 1000u, 100000u, 1000000u }) {
+		std::vector<std::uint32_t> keys(2 * n);
+		std::iota(keys.begin(), keys.end(), 1u);
+		std::ranges::shuffle(keys, rng);
+		keys.resize(n);
+		// about 10M lookups whatever the size
+		const std::uint32_t rounds = std::max(1u, 10000000 / n);
+
+		sparse_index s;
+		const double s_insert = ns_per(n, [&] {
+			for (std::uint32_t i = 0; i < n; ++i)
+				s.insert(keys[i], i);
+			return s.size();
+		});
+		std::unordered_map<std::uint32_t, std::uint32_t> m;
+		const double m_insert = ns_per(n, [&] {
+			for (std::uint32_t i = 0; i < n; ++i)
+				m.emplace(keys[i], i);
+			return m.size();
+		});
+
+		std::ranges::shuffle(keys, rng);
+		const double s_lookup = ns_per(std::uint64_t{n} * rounds, [&] {
+			std::uint32_t sum = 0;
+			for (std::uint32_t k = 0; k < rounds; ++k)
+				for (const auto key : keys)
+					sum += s.at(key);
+			return sum;
+		});
+		const double m_lookup = ns_per(std::uint64_t{n} * rounds, [&] {
+			std::uint32_t sum = 0;
+			for (std::uint32_t k = 0; k < rounds; ++k)
+				for (const auto key : keys)
+					sum += m.find(key)->second;
+			return sum;
+		});
+
+		std::ranges::shuffle(keys, rng);
+		const double s_erase = ns_per(n, [&] {
+			for (const auto key : keys)
+				s.erase(key);
+			return s.size();
+		});
+		const double m_erase = ns_per(n, [&] {
+			for (const auto key : keys)
+				m.erase(key);
+			return m.size();
+		});
+
+		std::print("[BENCH] sparse {}: insert {:.1f} ns, lookup {:.2f} ns, erase {:.1f} ns; "
+				"unordered_map {:.1f} / {:.2f} / {:.1f} ns\n",
+				n, s_insert, s_lookup, s_erase, m_insert, m_lookup, m_erase);
+	}
+	return bad? 1: 0;
+}
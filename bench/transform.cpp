@@ -0,0 +1,90 @@
+#include "c++lib.hpp"
+#include "system.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+// tfms::propagate over a random 100k entity hierarchy with every
+// entry dirty, with the scalar and the widest compose kernels, each
+// checked against a naive composition walking up the parents
+
+using namespace phobos;
+
+// parent * local the way a reader without tfms would do it
+static glm::mat3x2 naive(tfms const &store, entity e)
+{
+	const transform l = store.local(e);
+	const glm::mat3x2 m{ l.x(), l.y(), l.pos() };
+	if (!l.parent)
+		return m;
+	const auto p = naive(store, l.parent);
+	return {
+		p[0] * m[0].x + p[1] * m[0].y,
+		p[0] * m[1].x + p[1] * m[1].y,
+		p[0] * m[2].x + p[1] * m[2].y + p[2],
+	};
+}
+
+int main()
+{
+	// trees of about the size of a boss with its parts, a child
+	// hangs off any node of its tree built before it
+	constexpr std::uint32_t trees = 1000, per_tree = 100, count = trees * per_tree;
+	constexpr int rounds = 50;
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f), scale(0.5f, 2.0f), pos(-10.0f, 10.0f);
+
+	std::vector<entity> es(count);
+	spawn_block(es.data(), count);
+	tfms store;
+	for (std::uint32_t t = 0; t < trees; ++t) {
+		for (std::uint32_t i = 0; i < per_tree; ++i) {
+			const auto a = angle(rng), s = scale(rng);
+			const entity parent = i? es[t * per_tree + rng() % i]: 0;
+			store.transformable(es[t * per_tree + i], transform{
+				{
+					{ std::cos(a) * s, std::sin(a) * s },
+					{ -std::sin(a) * s, std::cos(a) * s },
+					{ pos(rng), pos(rng) },
+				},
+				parent,
+			});
+		}
+	}
+
+	std::vector<glm::mat3x2> want(count);
+	auto t0 = std::chrono::steady_clock::now();
+	for (std::uint32_t i = 0; i < count; ++i)
+		want[i] = naive(store, es[i]);
+	const double naive_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+	int failed = 0;
+	for (const bool simd : { false, true }) {
+		// init() only ever widens the kernel, scalar goes first
+		if (simd)
+			unsetenv("PHOBOS_SIMD");
+		else
+			setenv("PHOBOS_SIMD", "0", 1);
+		store.init();
+
+		double ms = 0.0;
+		for (int k = 0; k < rounds; ++k) {
+			for (std::uint32_t i = 0; i < count; ++i)
+				store.modify(i);
+			t0 = std::chrono::steady_clock::now();
+			store.propagate();
+			ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		}
+
+		std::uint32_t bad = 0;
+		for (std::uint32_t i = 0; i < count; ++i) {
+			const transform w = store.world(es[i]);
+			bad += !(w.x() == want[i][0] && w.y() == want[i][1] && w.pos() == want[i][2]);
+		}
+		failed += bad;
+		std::print("[BENCH] transform {} {}: {} mismatches, {:.3f} ms per propagate, naive {:.3f} ms\n",
+				count, simd? "simd": "scalar", bad, ms / rounds, naive_ms);
+	}
+	return failed? 1: 0;
+}
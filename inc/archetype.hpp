@@ -0,0 +1,210 @@
+#pragma once
+#include "c++lib.hpp"
+#include "entity.hpp"
+#include "system.hpp"
+#include <memory>
+
+namespace phobos {
+
+// entities with the same signature share a table, split in
+// fixed size chunks where every system in the signature owns
+// a column holding the entity's index into that system
+// so joining several systems is a linear walk over the columns
+// instead of one index() per system per entity
+class archetype_store
+{
+public:
+	enum : std::uint32_t { chunk_rows = 256 };
+	static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+	struct chunk_view
+	{
+		std::uint32_t size;
+		entity const *id;
+		std::uint32_t const *columns;
+		std::uint8_t const *slot;
+
+		std::uint32_t const *column(system_id sys) const;
+	};
+
+	void add(entity e, system_id sys);
+	void del(entity e, system_id sys);
+	void set(entity e, system_id sys, std::uint32_t idx);
+
+	template <typename F>
+	void query(signature with, F &&fn) const;
+
+	// tables are never destroyed, so a table id stays valid
+	// and tables() only grows
+	std::uint32_t tables() const;
+	bool matches(std::uint32_t t, signature with) const;
+	template <typename F>
+	void chunks(std::uint32_t t, F &&fn) const;
+
+private:
+	struct table
+	{
+		signature sig;
+		std::uint32_t rows;
+		std::uint8_t slot[static_cast<size_t>(system_id::NUM)];
+		std::uint32_t ncolumns;
+		// transitions already looked up, per system
+		std::uint32_t add[static_cast<size_t>(system_id::NUM)];
+		std::uint32_t del[static_cast<size_t>(system_id::NUM)];
+		// ids then ncolumns columns, chunk_rows each
+		std::vector<std::unique_ptr<std::uint32_t[]>> chunks;
+
+		std::uint32_t *ids(std::uint32_t row) const;
+		std::uint32_t *at(std::uint32_t row, std::uint32_t column) const;
+	};
+
+	struct location
+	{
+		std::uint32_t table;
+		std::uint32_t row;
+	};
+
+	std::uint32_t find(signature sig);
+	void move(entity e, std::uint32_t to);
+
+	std::vector<table> tables_;
+	std::unordered_map<unsigned long long, std::uint32_t> by_signature_;
+	std::vector<location> where_;
+};
+
+archetype_store &archetypes();
+
+inline std::uint32_t const *archetype_store::chunk_view::column(system_id sys) const
+{
+	const auto at = slot[static_cast<size_t>(sys)];
+	assert(at != std::numeric_limits<std::uint8_t>::max());
+	return columns + at * chunk_rows;
+}
+
+inline std::uint32_t archetype_store::tables() const
+{
+	return tables_.size();
+}
+
+inline bool archetype_store::matches(std::uint32_t t, signature with) const
+{
+	return (tables_[t].sig & with) == with;
+}
+
+template <typename F>
+void archetype_store::chunks(std::uint32_t t, F &&fn) const
+{
+	const auto &tbl = tables_[t];
+	for (std::uint32_t c = 0; c * chunk_rows < tbl.rows; ++c) {
+		const auto base = c * chunk_rows;
+		const chunk_view view{
+			std::min<std::uint32_t>(tbl.rows - base, chunk_rows),
+			tbl.chunks[c].get(),
+			tbl.chunks[c].get() + chunk_rows,
+			tbl.slot,
+		};
+		fn(view);
+	}
+}
+
+template <typename F>
+void archetype_store::query(signature with, F &&fn) const
+{
+	for (std::uint32_t t = 0; t < tables(); ++t) {
+		if (matches(t, with))
+			chunks(t, fn);
+	}
+}
+
+template <typename F>
+void query(std::initializer_list<system_id> with, F &&fn)
+{
+	signature sig;
+	for (const auto sys : with)
+		sig.set(static_cast<size_t>(sys));
+	archetypes().query(sig, std::forward<F>(fn));
+}
+
+// query that remembers which tables matched
+// rows moving between tables on add_component/del_component
+// need no bookkeeping here, only tables created since the
+// last walk are tested
+template <system_id... S>
+class view
+{
+public:
+	// fn(entity, index into S...)
+	template <typename F>
+	void each(F &&fn);
+	// same as each but chunks are spread over the job pool
+	// so fn must only write to what the row owns
+	template <typename F>
+	void par_each(F &&fn);
+	template <typename F>
+	void chunks(F &&fn);
+
+private:
+	void refresh();
+	template <typename F>
+	static void rows(archetype_store::chunk_view const &c, F &fn);
+
+	std::vector<std::uint32_t> matched_;
+	std::vector<archetype_store::chunk_view> chunks_;
+	std::uint32_t seen_ = 0;
+};
+
+template <system_id... S>
+void view<S...>::refresh()
+{
+	auto &store = archetypes();
+	signature sig;
+	(sig.set(static_cast<size_t>(S)), ...);
+	for (; seen_ < store.tables(); ++seen_) {
+		if (store.matches(seen_, sig))
+			matched_.push_back(seen_);
+	}
+}
+
+template <system_id... S>
+template <typename F>
+void view<S...>::chunks(F &&fn)
+{
+	refresh();
+	for (const auto t : matched_)
+		archetypes().chunks(t, fn);
+}
+
+template <system_id... S>
+template <typename F>
+void view<S...>::rows(archetype_store::chunk_view const &c, F &fn)
+{
+	const std::uint32_t *cols[] = { c.column(S)... };
+	[&] <size_t... I> (std::index_sequence<I...>)
+	{
+		for (std::uint32_t i = 0; i < c.size; ++i)
+			fn(c.id[i], cols[I][i]...);
+	}(std::make_index_sequence<sizeof...(S)>{});
+}
+
+template <system_id... S>
+template <typename F>
+void view<S...>::each(F &&fn)
+{
+	chunks([&] (archetype_store::chunk_view const &c) { rows(c, fn); });
+}
+
+template <system_id... S>
+template <typename F>
+void view<S...>::par_each(F &&fn)
+{
+	chunks_.clear();
+	chunks([this] (archetype_store::chunk_view const &c) { chunks_.push_back(c); });
+	system.jobs.parallel_for(0, chunks_.size(), 1, [&] (std::uint32_t begin, std::uint32_t end)
+	{
+		for (auto c = begin; c < end; ++c)
+			rows(chunks_[c], fn);
+	});
+}
+
+} // phobos
+
@@ -0,0 +1,76 @@
+#pragma once
+#include "c++lib.hpp"
+#include <glm/glm.hpp>
+#include "grid.hpp"
+
+namespace phobos {
+
+// static bounding volume hierarchy over the edges of a closed
+// polyline, built once by median splits. nodes are laid out depth
+// first, so an inner node's left child is the next node
+class edge_bvh
+{
+public:
+	enum : std::uint32_t { leaf_edges = 4, max_depth = 64 };
+
+	// edges are [i;i+1modN]
+	void build(std::vector<glm::vec2> const &loop);
+
+	// fn(from, swept) for the edges whose box overlaps box
+	// until it returns true, true if it did
+	template <typename F>
+	bool query(aabb const &box, F &&fn) const;
+
+	// squared distance from p to the closest edge
+	float nearest2(glm::vec2 p) const;
+	// even-odd rule
+	bool inside(glm::vec2 p) const;
+
+private:
+	struct edge
+	{
+		glm::vec2 from;
+		glm::vec2 to;
+	};
+
+	struct node
+	{
+		aabb box;
+		// first edge of a leaf, right child of an inner node
+		std::uint32_t at;
+		// 0 for inner nodes
+		std::uint32_t count;
+	};
+
+	std::uint32_t build(std::uint32_t begin, std::uint32_t end, std::uint32_t depth);
+
+	std::vector<edge> edges_;
+	std::vector<node> nodes_;
+};
+
+template <typename F>
+bool edge_bvh::query(aabb const &box, F &&fn) const
+{
+	if (nodes_.empty())
+		return false;
+	std::uint32_t stack[max_depth];
+	std::uint32_t top = 0;
+	stack[top++] = 0;
+	while (top) {
+		const auto at = stack[--top];
+		const auto &n = nodes_[at];
+		if (!overlap(n.box, box))
+			continue;
+		if (!n.count) {
+			stack[top++] = n.at;
+			stack[top++] = at+1;
+			continue;
+		}
+		for (auto e = n.at; e < n.at + n.count; ++e)
+			if (fn(edges_[e].from, edges_[e].to - edges_[e].from))
+				return true;
+	}
+	return false;
+}
+
+} // phobos
@@ -0,0 +1,69 @@
+#pragma once
+#include "c++lib.hpp"
+#include "entity.hpp"
+#include "system_id.hpp"
+#include <functional>
+
+namespace phobos {
+
+// structural changes made from a system's update are recorded
+// here instead of touching the entity index, then applied once
+// the frame graph is done. every thread has its own buffer and
+// flush() replays them by recording system in system_id order,
+// then by position in that system's update, then in recording
+// order, so which worker ran a system or a task doesn't change
+// the result. tasks a system spreads over the job pool record
+// under that system, each at a position of its own between what
+// the system recorded before and after the parallel_for
+class commands
+{
+public:
+	// what the calling thread records for
+	struct origin
+	{
+		system_id by;
+		std::uint64_t order;
+	};
+
+	// handles reserved per thread at every flush
+	enum : std::uint32_t { block_size = 64 };
+
+	// alive right away but without components, so it can be
+	// kept and passed to later commands of the same frame
+	entity spawn();
+	// attach runs at flush and is expected to give e the sys
+	// component through that system's own constructor
+	void add(entity e, system_id sys, std::function<void()> attach);
+	void remove(entity e, system_id sys);
+	void despawn(entity e);
+
+	// one buffer per job thread, before the first frame
+	static void init(unsigned threads);
+	// the calling thread's buffer
+	static commands &local();
+	static origin recording();
+	// set by the schedule around each system's update and by the
+	// job pool around each task, returns the one it replaces
+	static origin recording(origin at);
+	// the first of count positions for the tasks of a parallel_for,
+	// what the calling thread records next goes after them. a
+	// parallel_for nested in a task isn't ordered against its siblings
+	static std::uint64_t fork(std::uint32_t count);
+	// main thread, no system running
+	static void flush();
+
+private:
+	struct command
+	{
+		enum kind_t : std::uint8_t { add_op, remove_op, despawn_op } kind;
+		origin from;
+		system_id sys;
+		entity e;
+		std::function<void()> attach;
+	};
+
+	std::vector<command> commands_;
+	std::vector<entity> block_;
+};
+
+} // phobos
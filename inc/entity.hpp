@@ -3,12 +3,35 @@
 
 namespace phobos {
 
+// generation << index_bits | index
+// index 0 is never handed out so a null handle is still 0
 using entity = std::uint32_t;
 
+enum : std::uint32_t {
+	entity_index_bits = 22,
+	entity_index_mask = (1u << entity_index_bits) - 1,
+	entity_generation_mask = (1u << (32 - entity_index_bits)) - 1,
+};
+
+constexpr std::uint32_t entity_index(entity e)
+{
+	return e & entity_index_mask;
+}
+
+constexpr std::uint32_t entity_generation(entity e)
+{
+	return e >> entity_index_bits;
+}
+
+// spawn() and spawn_block() may be called from any thread
 entity spawn();
+// n handles for the price of one lock
+void spawn_block(entity *out, std::uint32_t n);
 void despawn(entity);
+bool alive(entity);
 void update();
 
+// despawned by the last update()
 const std::vector<entity> &dead_this_tick();
 
 } // phobos
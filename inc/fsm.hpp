@@ -1,11 +1,18 @@
 #pragma once
 #include "c++lib.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 #include "vector.hpp"
 
 namespace phobos {
 
 struct fsm {
+	static constexpr system_id id = system_id::fsm;
+	// ranges are phys queries against the last tick's colliders
+	static constexpr std::uint64_t reads = access({ system_id::tfms, system_id::fsm, system_id::phys }, { buffer::events, buffer::structure });
+	// spawning, timers and despawns go through commands
+	static constexpr std::uint64_t writes = access({ system_id::tfms, system_id::fsm });
+
 	enum type : std::uint32_t {
 		enemy_dumb0,
 		slash,
@@ -49,8 +56,9 @@ struct fsm {
 
 	struct enemy_dumb0_t : state_machine
 	{
-		entity fight_range;
-		entity sight_range;
+		// diameters in units of the enemy's size
+		float fight_range;
+		float sight_range;
 		entity slash;
 	};
 
@@ -73,6 +81,10 @@ struct fsm {
 
 struct dispatch
 {
+	static constexpr system_id id = system_id::dispatch;
+	static constexpr std::uint64_t reads = access({ system_id::dispatch }, { buffer::collisions });
+	static constexpr std::uint64_t writes = access({}, { buffer::events });
+
 	int init();
 	void fini();
 	void update(float now, float dt);
@@ -105,6 +117,10 @@ private:
 
 struct dispatch_timeout
 {
+	static constexpr system_id id = system_id::dispatch_timeout;
+	static constexpr std::uint64_t reads = access({ system_id::dispatch_timeout }, { buffer::timeouts });
+	static constexpr std::uint64_t writes = access({}, { buffer::events });
+
 	int init();
 	void fini();
 	void update(float, float);
@@ -121,6 +137,11 @@ struct dispatch_timeout
 
 struct dispatch_death
 {
+	static constexpr system_id id = system_id::dispatch_death;
+	static constexpr std::uint64_t reads = access({ system_id::dispatch_death }, { buffer::deaths });
+	// also clears the events of the whole frame
+	static constexpr std::uint64_t writes = access({}, { buffer::events });
+
 	int init();
 	void fini();
 	void update(float, float);
@@ -0,0 +1,106 @@
+#pragma once
+#include "c++lib.hpp"
+#include <glm/glm.hpp>
+#include <cmath>
+
+namespace phobos {
+
+struct aabb
+{
+	glm::vec2 min;
+	glm::vec2 max;
+};
+
+bool overlap(aabb const &a, aabb const &b);
+
+// spatial hash rebuilt every tick: a box goes in every cell it
+// overlaps and a pair is reported once, by the first cell (lowest
+// x then y) both boxes overlap. boxes covering more than max_span
+// cells on an axis are tested against everything instead
+class grid
+{
+public:
+	enum : std::int32_t { max_span = 16 };
+
+	float cell_size = 1.0f;
+
+	void clear();
+	// ref is handed back as is by pairs()
+	void insert(aabb const &box, std::uint32_t ref);
+	void build();
+	// fn(ref, ref) for every overlapping pair of boxes
+	template <typename F>
+	void pairs(F &&fn) const;
+
+private:
+	struct entry
+	{
+		std::int32_t x;
+		std::int32_t y;
+		std::uint32_t obj;
+	};
+
+	std::int32_t cell(float at) const;
+	std::uint32_t bucket(std::int32_t x, std::int32_t y) const;
+
+	std::vector<aabb> boxes_;
+	std::vector<std::uint32_t> refs_;
+	std::vector<std::uint8_t> big_;
+	std::vector<std::uint32_t> bigs_;
+	std::vector<entry> pending_;
+	// sorted by bucket, starts_ has one more entry than buckets
+	std::vector<entry> entries_;
+	std::vector<std::uint32_t> starts_;
+	std::uint32_t mask_ = 0;
+};
+
+inline bool overlap(aabb const &a, aabb const &b)
+{
+	return a.min.x <= b.max.x && b.min.x <= a.max.x
+	    && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+inline std::int32_t grid::cell(float at) const
+{
+	return static_cast<std::int32_t>(std::floor(at / cell_size));
+}
+
+inline std::uint32_t grid::bucket(std::int32_t x, std::int32_t y) const
+{
+	const auto h = static_cast<std::uint32_t>(x) * 0x9e3779b1u ^ static_cast<std::uint32_t>(y) * 0x85ebca77u;
+	return (h ^ h >> 16) & mask_;
+}
+
+template <typename F>
+void grid::pairs(F &&fn) const
+{
+	for (std::uint32_t b = 0; b+1 < starts_.size(); ++b) {
+		for (auto i = starts_[b]; i < starts_[b+1]; ++i) {
+			const auto &p = entries_[i];
+			for (auto j = i+1; j < starts_[b+1]; ++j) {
+				const auto &q = entries_[j];
+				// another cell landing in the same bucket
+				if (p.x != q.x || p.y != q.y)
+					continue;
+				const auto &l = boxes_[p.obj];
+				const auto &r = boxes_[q.obj];
+				if (!overlap(l, r))
+					continue;
+				if (std::max(cell(l.min.x), cell(r.min.x)) != p.x || std::max(cell(l.min.y), cell(r.min.y)) != p.y)
+					continue;
+				fn(refs_[p.obj], refs_[q.obj]);
+			}
+		}
+	}
+	for (const auto big : bigs_) {
+		for (std::uint32_t obj = 0; obj < boxes_.size(); ++obj) {
+			// big pairs once, from the lower one
+			if (obj == big || (big_[obj] && obj < big))
+				continue;
+			if (overlap(boxes_[big], boxes_[obj]))
+				fn(refs_[big], refs_[obj]);
+		}
+	}
+}
+
+} // phobos
@@ -1,6 +1,7 @@
 #pragma once
 #include "c++lib.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 
 namespace phobos {
 
@@ -12,13 +13,17 @@ struct hp_t {
 };
 
 struct hp {
+	static constexpr system_id id = system_id::hp;
+	static constexpr std::uint64_t reads = access({ system_id::hp, system_id::phys }, { buffer::collisions, buffer::structure });
+	static constexpr std::uint64_t writes = access({ system_id::hp });
+
 	int init();
 	void fini();
 	void update(float, float);
 	void remove(entity e);
 
 	std::vector<hp_t> living_;
-	std::vector<entity> id;
+	std::vector<entity> id_;
 
 	void damageable(entity e, float initial);
 };
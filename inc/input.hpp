@@ -2,6 +2,7 @@
 #include "c++lib.hpp"
 #include "window.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 
 namespace phobos {
 
@@ -40,13 +41,16 @@ enum class key {
 };
 
 struct input {
+	static constexpr system_id id = system_id::input;
+	static constexpr std::uint64_t reads = 0;
+	static constexpr std::uint64_t writes = access({ system_id::input });
+
 	bool held(key k) const;
 	bool pressed(key k) const;
 
 	int init();
 	void fini();
 	void update(float now, float dt);
-	void remove(std::uint32_t idx);
 
 	window win;
 private:
@@ -54,10 +58,12 @@ private:
 };
 
 struct gl {
+	static constexpr system_id id = system_id::gl;
+	static constexpr std::uint64_t reads = 0;
+	static constexpr std::uint64_t writes = 0;
+
 	int init();
 	void fini();
-	void update(float, float);
-	void remove(entity e);
 };
 
 } // phobos
@@ -0,0 +1,141 @@
+#pragma once
+#include "c++lib.hpp"
+#include "system_id.hpp"
+#include "command.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace phobos {
+
+// work stealing pool, every thread owns a deque it pushes and
+// pops at the back, idle threads take half of someone else's
+// deque from the front. the main thread is worker 0 and helps
+// while it waits so nothing ever blocks on a running frame
+class jobs
+{
+public:
+	static constexpr system_id id = system_id::jobs;
+	static constexpr std::uint64_t reads = 0;
+	static constexpr std::uint64_t writes = 0;
+
+	static constexpr unsigned automatic = std::numeric_limits<unsigned>::max();
+
+	// set before init(), PHOBOS_WORKERS and PHOBOS_PIN override them
+	// automatic is one thread per core, main thread included
+	unsigned worker_count = automatic;
+	bool pinned = false;
+
+	int init();
+	void fini();
+
+	// threads running tasks, main thread included
+	unsigned size() const;
+	// calling thread in [0, size()), 0 is the main thread
+	static unsigned self();
+
+	// fn(begin, end) over [begin, end) cut in ranges of at most grain
+	// small ranges run inline without touching the queues
+	template <typename F>
+	void parallel_for(std::uint32_t begin, std::uint32_t end, std::uint32_t grain, F &&fn);
+
+	class graph
+	{
+	public:
+		// main_thread nodes are only ever run by worker 0
+		std::uint32_t add(std::function<void()> fn, bool main_thread = false);
+		// after starts once before is done
+		void depend(std::uint32_t before, std::uint32_t after);
+		void clear();
+		size_t size() const;
+
+	private:
+		friend jobs;
+		struct node
+		{
+			std::function<void()> fn;
+			std::vector<std::uint32_t> next;
+			std::uint32_t deps;
+			std::atomic<std::uint32_t> waiting;
+			bool main_thread;
+		};
+
+		// deque since atomics can't be moved around
+		std::deque<node> nodes_;
+		std::atomic<std::uint32_t> *pending_;
+		jobs *pool_;
+	};
+
+	// blocks until every node of g ran
+	void run(graph &g);
+
+private:
+	struct task
+	{
+		void (*fn)(void *ctx, std::uint32_t begin, std::uint32_t end);
+		void *ctx;
+		std::uint32_t begin;
+		std::uint32_t end;
+		std::atomic<std::uint32_t> *pending;
+		// the system the pushing thread recorded commands for and
+		// where this task's go among them
+		commands::origin from;
+	};
+
+	struct worker
+	{
+		std::mutex lock;
+		std::deque<task> queue;
+		// never stolen
+		std::deque<task> pinned;
+	};
+
+	static void run_node(void *ctx, std::uint32_t node, std::uint32_t);
+
+	void push(task const &t);
+	void push_main(task const &t);
+	bool pop(task *t);
+	bool steal(task *t);
+	void execute(task const &t);
+	void wait(std::atomic<std::uint32_t> const &pending);
+	void loop(unsigned self);
+
+	std::unique_ptr<worker[]> workers_;
+	std::vector<std::thread> threads_;
+	std::atomic<std::uint32_t> queued_;
+	std::atomic<bool> quit_;
+	std::mutex sleep_lock_;
+	std::condition_variable sleep_;
+};
+
+template <typename F>
+void jobs::parallel_for(std::uint32_t begin, std::uint32_t end, std::uint32_t grain, F &&fn)
+{
+	assert(grain);
+	if (begin >= end)
+		return;
+	if (end - begin <= grain || size() <= 1) {
+		fn(begin, end);
+		return;
+	}
+	using fn_t = std::remove_reference_t<F>;
+	const auto call = [] (void *ctx, std::uint32_t b, std::uint32_t e)
+	{
+		(*static_cast<fn_t*>(ctx))(b, e);
+	};
+	void *ctx = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+	const std::uint32_t count = (end - begin + grain - 1) / grain;
+	std::atomic<std::uint32_t> pending = count;
+	const auto by = commands::recording().by;
+	auto order = commands::fork(count);
+	for (auto at = begin; at < end; at += std::min(grain, end - at))
+		push(task{ call, ctx, at, at + std::min(grain, end - at), &pending, { by, order++ } });
+	wait(pending);
+}
+
+} // phobos
+
@@ -0,0 +1,48 @@
+#pragma once
+#include "c++lib.hpp"
+
+namespace phobos {
+
+// pairs tested lane by lane, 8 at a time, stored as structures of
+// arrays so every field loads as one register. to test one shape
+// against many, repeat it in every lane
+enum : std::uint32_t { block_lanes = 8 };
+
+struct circle_block
+{
+	float x[block_lanes];
+	float y[block_lanes];
+	float r[block_lanes];
+};
+
+struct ray_block
+{
+	float ox[block_lanes];
+	float oy[block_lanes];
+	float sx[block_lanes];
+	float sy[block_lanes];
+};
+
+struct triangle_block
+{
+	float ox[block_lanes];
+	float oy[block_lanes];
+	float ux[block_lanes];
+	float uy[block_lanes];
+	float vx[block_lanes];
+	float vy[block_lanes];
+};
+
+// bit i is set when lane i of l hits lane i of r, lanes from n on
+// are never set. same results as the scalar collision_test
+std::uint32_t test_block(circle_block const &l, circle_block const &r, std::uint32_t n);
+std::uint32_t test_block(circle_block const &l, ray_block const &r, std::uint32_t n);
+std::uint32_t test_block(circle_block const &l, triangle_block const &r, std::uint32_t n);
+
+enum class simd { scalar, sse2, avx };
+
+// picks the widest kernels up to widest that the cpu runs and
+// returns which, PHOBOS_SIMD=0 forces the scalar ones
+simd select_block_kernels(simd widest = simd::avx);
+
+} // phobos
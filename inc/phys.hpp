@@ -2,7 +2,16 @@
 #include "c++lib.hpp"
 #include <glm/glm.hpp>
 #include "entity.hpp"
+#include "system_id.hpp"
 #include "transform.hpp"
+#include "grid.hpp"
+#include "sweep.hpp"
+#include "tree.hpp"
+#include "narrow.hpp"
+#include "bvh.hpp"
+#include "sdf.hpp"
+#include "sparse.hpp"
+#include <span>
 
 namespace phobos {
 
@@ -33,13 +42,24 @@ struct wall_mesh : std::vector<glm::vec2> // [i;i+1modN] edges
 	enum { bit = 3 };
 };
 
+bool collision_test(circle const &c1, circle const &c2);
 bool collision_test(circle const &c, ray const &r);
 bool collision_test(circle const &c, triangle const &t);
 bool collision_test(ray const &r1, ray const &r2);
 bool collision_test(circle const &c, wall_mesh const &m);
 
+// fraction of the motions before the circles first touch, 0 if they
+// already do and above 1 if they never do
+float time_of_impact(circle const &c1, glm::vec2 m1, circle const &c2, glm::vec2 m2);
+// same for c moving by m against the segment r
+float time_of_impact(circle const &c, glm::vec2 m, ray const &r);
+
 struct deriv
 {
+	static constexpr system_id id = system_id::deriv;
+	static constexpr std::uint64_t reads = access({ system_id::deriv, system_id::tfms });
+	static constexpr std::uint64_t writes = access({ system_id::tfms });
+
 	int init();
 	void fini();
 	void update(float now, float dt);
@@ -52,10 +72,36 @@ struct deriv
 
 struct phys
 {
+	static constexpr system_id id = system_id::phys;
+	static constexpr std::uint64_t reads = access({ system_id::tfms, system_id::phys }, { buffer::structure });
+	static constexpr std::uint64_t writes = access({ system_id::phys }, { buffer::collisions });
+
+	// two colliders are only tested when each one's layer
+	// is in the other's mask
+	enum : std::uint32_t {
+		body       = 1u << 0,
+		sensor     = 1u << 1,
+		attack     = 1u << 2,
+		wall       = 1u << 3,
+		everything = ~0u,
+	};
+
 	template <typename T>
 	struct collider : T
 	{
 		entity id;
+		std::uint32_t layer;
+		std::uint32_t mask;
+		// static, only placed when stale
+		bool fixed = false;
+		bool stale = false;
+		// box as of the last update() and ticks it has not moved for
+		aabb rest = {};
+		std::uint32_t still = 0;
+		bool asleep = false;
+		// origin as of the update() before, once placed
+		glm::vec2 last = {};
+		bool placed = false;
 	};
 
 	// possible better representation
@@ -69,30 +115,259 @@ struct phys
 	std::vector<collider<triangle>> triangle_;
 	std::vector<collider<ray>> ray_;
 	std::vector<collider<wall_mesh>> wall_mesh_;
+	// same order as wall_mesh_, fields are empty unless baked
+	std::vector<edge_bvh> wall_bvh_;
+	std::vector<distance_field> wall_sdf_;
 
 	enum : std::uint32_t { type_shift = 2, type_mask = (1<<type_shift) - 1 };
 	static_assert(type_mask >= static_cast<std::uint32_t>(collider<wall_mesh>::bit), "increase type_shift");
 
-	void collider_circle(entity e);
-	void collider_triangle(entity e);
-	void collider_ray(entity e);
-	void collider_wall_mesh(entity e, wall_mesh const &m);
+	void collider_circle(entity e, std::uint32_t layer = body, std::uint32_t mask = everything);
+	void collider_triangle(entity e, std::uint32_t layer = attack, std::uint32_t mask = body | sensor | wall);
+	void collider_ray(entity e, std::uint32_t layer = sensor, std::uint32_t mask = body | attack | wall);
+	void collider_wall_mesh(entity e, wall_mesh const &m, std::uint32_t layer = wall, std::uint32_t mask = body | attack);
 	std::uint32_t collider_type(entity e);
 	void update_colliders();
 
+	// a static collider is placed from its transform on the next
+	// update() and then stays put in an index of its own: it is not
+	// refreshed every tick and never tested against another static
+	// one. walls always are static
+	void make_static(entity e);
+	// a static collider moved, place it again on the next update()
+	void invalidate(entity e);
+
 	struct collision_data
 	{
 		entity main;
 		entity other;
 	};
 
+	// every pair touching as of the last update(), both ways round
 	std::vector<collision_data> colliding;
+	// the same pairs by how they changed since the update() before:
+	// they started touching, kept touching or stopped. ended can name
+	// colliders removed since
+	std::vector<collision_data> began;
+	std::vector<collision_data> persisting;
+	std::vector<collision_data> ended;
+
+	// pairs sorted by main, so the rows of one entity are found
+	// without searching, and an entity has rows only while in one
+	class contact_index
+	{
+	public:
+		// sorts pairs, which have to outlive the index
+		void build(std::vector<collision_data> &pairs);
+		bool contains(entity e) const;
+		std::span<collision_data const> of(entity e) const;
+		// entities with at least one row
+		std::span<entity const> entities() const;
+
+	private:
+		struct rows
+		{
+			// 0 or an older generation when e has no row
+			entity e;
+			std::uint32_t first;
+			std::uint32_t count;
+		};
+
+		std::span<collision_data const> pairs_;
+		paged_array<rows, entity_index_bits> rows_;
+		std::vector<entity> entities_;
+	};
+
+	// colliding and began by entity
+	contact_index colliding_by;
+	contact_index began_by;
+
+	struct impact
+	{
+		entity main;
+		entity other;
+		// fraction of the last update()'s motion before they touched
+		float t;
+	};
+
+	// pairs of the swept circles in colliding, earliest first
+	std::vector<impact> impacts;
+
+	// pairs of the last update() past the broadphase, by whether
+	// their layers and the subscribers let them reach the narrowphase
+	std::uint32_t tested = 0;
+	std::uint32_t skipped = 0;
+	// dynamic colliders at the end of the last update()
+	std::uint32_t awake = 0;
+	std::uint32_t sleeping = 0;
+
+	// only pairs someone subscribed to are tested: e against with,
+	// e against anything when with is 0, or a layer against another.
+	// while a wildcard is subscribed every pair is
+	void subscribe(entity e, entity with);
+	void unsubscribe(entity e, entity with);
+	void subscribe_layers(std::uint32_t l, std::uint32_t r);
+	void subscribe_all();
+	void unsubscribe_all();
+
+	enum class broadphase { brute, grid, sweep };
+
+	// set before init(), PHOBOS_BROADPHASE=brute|grid|sweep and
+	// PHOBOS_CELL override them
+	broadphase mode = broadphase::grid;
+	// a bit more than the common collider keeps most in 1 to 4 cells
+	float cell_size = 2.0f;
+	// dynamic colliders that have not moved by more than sleep_epsilon
+	// for sleep_ticks ticks sleep: they are only tested against awake
+	// colliders, which wake them, and their other pairs are carried
+	// over from the last tick. PHOBOS_SLEEP overrides sleep_ticks, 0
+	// keeps everything awake
+	std::uint32_t sleep_ticks = 30;
+	float sleep_epsilon = 1e-3f;
+	// circles that moved by more than this much of their radius since
+	// the last update() are swept from where they were against walls
+	// and circles, so a large dt can't carry them through one. the
+	// other pairs only see where they are. PHOBOS_CCD overrides it,
+	// 0 sweeps none
+	float ccd_fraction = 0.5f;
+	// walls get a distance field with samples this far apart that
+	// settles most circle tests without touching the edges, 0 for
+	// none. PHOBOS_SDF overrides it and PHOBOS_SDF_CACHE names a
+	// directory to keep baked fields in
+	float sdf_cell = 0.0f;
+
+	struct hit
+	{
+		entity e;
+		// fraction of the segment before the hit
+		float t;
+	};
+
+	// queries see the colliders as of the last update(), and
+	// only those with a layer in mask
+	// fn(entity) for the colliders whose bounds overlap box
+	template <typename F>
+	void query_aabb(aabb const &box, F &&fn, std::uint32_t mask = everything) const;
+	// fn(entity) for the colliders touching the disk
+	template <typename F>
+	void query_circle(glm::vec2 center, float radius, F &&fn, std::uint32_t mask = everything) const;
+	// first collider but ignore crossed on the way, e is 0 if none
+	hit raycast(glm::vec2 from, glm::vec2 to, entity ignore = 0, std::uint32_t mask = everything) const;
 
 	int init();
 	void fini();
 	void update(float now, float dt);
 	void remove(entity e);
+
+private:
+	entity entity_of(std::uint32_t ref) const;
+	// layer and mask
+	std::pair<std::uint32_t, std::uint32_t> layers_of(std::uint32_t ref) const;
+	std::uint32_t layer_of(entity e) const;
+	bool filtered(std::uint32_t l, std::uint32_t r) const;
+	bool subscribed(std::uint32_t l, std::uint32_t r) const;
+	void narrowphase(std::uint32_t l, std::uint32_t r);
+	void narrowphase_blocks();
+	void track(entity e, aabb const &box);
+	void place_static(entity e);
+	// fn(collider) for any non wall collider
+	template <typename F>
+	void visit(std::uint32_t ref, F &&fn);
+	void settle();
+	void sleep(entity e, aabb const &box);
+	void wake(entity e);
+	// asleep or static
+	bool resting(entity e) const;
+	// sorts colliding into began, persisting and ended
+	void publish();
+	bool touches(entity e, aabb const &box) const;
+	bool touches(entity e, circle const &c) const;
+	// shape against the edges of wall_mesh_[w]
+	template <typename T>
+	bool hits_wall(T const &shape, std::uint32_t w) const;
+	// moved far enough since the last update() to be swept
+	bool fast(collider<circle> const &c) const;
+	// time_of_impact of c against the edges of wall_mesh_[w]
+	float sweep_wall(collider<circle> const &c, std::uint32_t w) const;
+	// fraction of r before it enters e, above 1 if it never does
+	float cast(entity e, ray const &r) const;
+
+	grid grid_;
+	sweep_and_prune sweep_;
+	std::vector<aabb> bounds_;
+	std::vector<std::uint32_t> refs_;
+	// circle pairs queued by type for the block kernels
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> circle_circle_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> circle_ray_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> circle_triangle_;
+	// every collider, kept across ticks for the queries
+	aabb_tree tree_;
+	// entity index -> tree leaf
+	sparse_index leaves_;
+	// static colliders only, persistent, exact boxes
+	aabb_tree static_tree_;
+	// entity index -> static_tree_ leaf
+	sparse_index static_leaves_;
+	// static colliders to place on the next update()
+	std::vector<entity> stale_;
+	// sleeping colliders only, exact boxes
+	aabb_tree sleeping_tree_;
+	// entity index -> sleeping_tree_ leaf
+	sparse_index sleeping_leaves_;
+	std::vector<entity> waking_;
+	// lower entity << 32 | higher entity -> update() that last saw
+	// the pair touching, every pair touching as of the last one
+	std::unordered_map<std::uint64_t, std::uint32_t> contacts_;
+	std::uint32_t frame_ = 0;
+
+	// entity index -> subscriptions of e against anything
+	sparse_index watched_;
+	// lower entity << 32 | higher entity -> subscriptions
+	std::unordered_map<std::uint64_t, std::uint32_t> watched_pairs_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> watched_layers_;
+	std::uint32_t wildcards_ = 0;
 };
 
+inline bool phys::contact_index::contains(entity e) const
+{
+	const auto at = rows_.find(entity_index(e));
+	return at && at->e == e;
+}
+
+inline std::span<phys::collision_data const> phys::contact_index::of(entity e) const
+{
+	const auto at = rows_.find(entity_index(e));
+	if (!at || at->e != e)
+		return {};
+	return pairs_.subspan(at->first, at->count);
+}
+
+inline std::span<entity const> phys::contact_index::entities() const
+{
+	return entities_;
+}
+
+template <typename F>
+void phys::query_aabb(aabb const &box, F &&fn, std::uint32_t mask) const
+{
+	tree_.query(box, [&] (entity e)
+	{
+		if ((layer_of(e) & mask) && touches(e, box))
+			fn(e);
+	});
+}
+
+template <typename F>
+void phys::query_circle(glm::vec2 center, float radius, F &&fn, std::uint32_t mask) const
+{
+	const glm::vec2 r{ radius, radius };
+	const circle c{ center, radius };
+	tree_.query(aabb{ center - r, center + r }, [&] (entity e)
+	{
+		if ((layer_of(e) & mask) && touches(e, c))
+			fn(e);
+	});
+}
+
 } // phobos
 
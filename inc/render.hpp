@@ -5,6 +5,7 @@
 #include "texture.hpp"
 #include "window.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 #include "phys.hpp"
 #include "transform.hpp"
 
@@ -19,6 +20,12 @@ struct full_wall_mesh {
 class render
 {
 public:
+	static constexpr system_id id = system_id::render;
+	static constexpr std::uint64_t reads = access({ system_id::input, system_id::tfms, system_id::hp, system_id::render }, { buffer::collisions, buffer::structure });
+	static constexpr std::uint64_t writes = access({ system_id::render });
+	// owns the GL context
+	static constexpr bool main_thread = true;
+
 	enum object {
 		// offline, build a triangle (inside) mesh describing
 		// where you can walk, ordered so that vertices i,i+1modN
@@ -53,6 +60,14 @@ private:
 
 	per_draw ctx[NUM];
 	std::vector<entity> drawing_[NUM];
+
+	struct model {
+		entity id;
+		transform world;
+	};
+
+	// filled every frame from the archetype tables
+	std::vector<model> models_[NUM];
 	GLuint attack_cone_mesh_vb;
 
 	struct quad {
@@ -0,0 +1,43 @@
+#pragma once
+#include "c++lib.hpp"
+#include "system_id.hpp"
+#include "job.hpp"
+
+namespace phobos {
+
+// runs the updating systems as a graph built from their declared
+// access: a system waits on every earlier system it conflicts with
+// (one writes what the other reads or writes) so a frame gives the
+// same result as running them one after the other in system_id order
+class schedule
+{
+public:
+	void build();
+	void run(float now, float dt);
+	// stages and how long each system took last frame
+	// PHOBOS_SCHEDULE=N prints it every N frames
+	void dump() const;
+
+private:
+	struct slot
+	{
+		system_id id;
+		std::uint32_t stage;
+		float begin_ms;
+		float end_ms;
+	};
+
+	std::vector<slot> slots_;
+	std::uint32_t stages_;
+	jobs::graph graph_;
+	float now_;
+	float dt_;
+	double frame_start_;
+	std::uint64_t frame_;
+	std::uint64_t dump_every_;
+};
+
+schedule &frame_schedule();
+
+} // phobos
+
@@ -0,0 +1,48 @@
+#pragma once
+#include "c++lib.hpp"
+#include <glm/glm.hpp>
+#include "bvh.hpp"
+
+namespace phobos {
+
+// signed distance to a closed polyline sampled on a regular grid,
+// negative inside. a bilinear lookup is within slack() of the
+// exact distance since the distance changes no faster than 1
+class distance_field
+{
+public:
+	struct sample
+	{
+		float distance;
+		// points away from the closest edge, not normalized
+		glm::vec2 gradient;
+	};
+
+	// samples every cell over the bounds of loop grown by margin
+	// with cache_dir set, a field baked earlier from the same loop
+	// is read back from there, or the new one is written there
+	void bake(edge_bvh const &edges, std::vector<glm::vec2> const &loop,
+			float cell, float margin, std::string_view cache_dir = {});
+
+	bool empty() const;
+	bool covers(glm::vec2 p) const;
+	float slack() const;
+	// p must be covered
+	float distance(glm::vec2 p) const;
+	sample at(glm::vec2 p) const;
+
+private:
+	bool load(std::string const &path, std::uint64_t hash);
+	void save(std::string const &path, std::uint64_t hash) const;
+	// corner cell and where p is in it
+	void locate(glm::vec2 p, std::uint32_t *x, std::uint32_t *y, glm::vec2 *f) const;
+
+	glm::vec2 origin_;
+	float cell_ = 0.0f;
+	std::uint32_t width_ = 0;
+	std::uint32_t height_ = 0;
+	// row major, width_ per row
+	std::vector<float> values_;
+};
+
+} // phobos
@@ -0,0 +1,111 @@
+#pragma once
+#include "c++lib.hpp"
+#include <memory>
+
+namespace phobos {
+
+// paged sparse set: key -> dense slot through a page table,
+// pages are only allocated once a key lands in them
+// so lookups are two array loads and never hash
+class sparse_index
+{
+public:
+	enum : std::uint32_t { page_shift = 12, page_size = 1u << page_shift, page_mask = page_size - 1 };
+	static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+	bool contains(std::uint32_t key) const;
+	std::uint32_t &at(std::uint32_t key);
+	void insert(std::uint32_t key, std::uint32_t value);
+	void erase(std::uint32_t key);
+	void clear();
+
+	size_t size() const;
+	std::uint32_t const *keys() const;
+
+private:
+	std::uint32_t *slot(std::uint32_t key) const;
+
+	std::vector<std::unique_ptr<std::uint32_t[]>> pages_;
+	std::vector<std::uint32_t> keys_;
+	std::vector<std::uint32_t> values_;
+};
+
+inline std::uint32_t *sparse_index::slot(std::uint32_t key) const
+{
+	const auto page = key >> page_shift;
+	if (page >= pages_.size() || !pages_[page])
+		return nullptr;
+	return &pages_[page][key & page_mask];
+}
+
+inline bool sparse_index::contains(std::uint32_t key) const
+{
+	const auto at = slot(key);
+	return at && *at != none;
+}
+
+inline std::uint32_t &sparse_index::at(std::uint32_t key)
+{
+	const auto at = slot(key);
+	assert(at && *at != none);
+	return values_[*at];
+}
+
+inline size_t sparse_index::size() const
+{
+	return keys_.size();
+}
+
+inline std::uint32_t const *sparse_index::keys() const
+{
+	return keys_.data();
+}
+
+// fixed page table over a bounded key space, a page is
+// allocated once and never moves so readers of keys they got
+// through some synchronisation need no lock, only ensure()
+// has to be serialised by the caller
+template <typename T, unsigned key_bits>
+class paged_array
+{
+public:
+	enum : std::uint32_t { page_shift = 12, page_size = 1u << page_shift, page_mask = page_size - 1 };
+	enum : std::uint32_t { page_count = ((1u << key_bits) + page_mask) >> page_shift };
+
+	// null when the key's page was never allocated
+	T *find(std::uint32_t key) const;
+	T &operator[](std::uint32_t key) const;
+	// fresh pages are value initialised
+	void ensure(std::uint32_t key);
+
+private:
+	std::unique_ptr<T[]> pages_[page_count];
+};
+
+template <typename T, unsigned key_bits>
+inline T *paged_array<T, key_bits>::find(std::uint32_t key) const
+{
+	const auto page = key >> page_shift;
+	if (page >= page_count || !pages_[page])
+		return nullptr;
+	return &pages_[page][key & page_mask];
+}
+
+template <typename T, unsigned key_bits>
+inline T &paged_array<T, key_bits>::operator[](std::uint32_t key) const
+{
+	assert((key >> page_shift) < page_count && pages_[key >> page_shift]);
+	return pages_[key >> page_shift][key & page_mask];
+}
+
+template <typename T, unsigned key_bits>
+void paged_array<T, key_bits>::ensure(std::uint32_t key)
+{
+	const auto page = key >> page_shift;
+	assert(page < page_count);
+	if (!pages_[page])
+		pages_[page] = std::make_unique<T[]>(page_size);
+}
+
+} // phobos
+
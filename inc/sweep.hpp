@@ -0,0 +1,82 @@
+#pragma once
+#include "c++lib.hpp"
+#include "entity.hpp"
+#include "grid.hpp"
+#include "sparse.hpp"
+#include <unordered_set>
+
+namespace phobos {
+
+// sort and sweep on x kept from one tick to the next: endpoints
+// are repaired by an insertion sort, close to linear when things
+// barely move, and a min crossing a max starts or ends an x
+// overlap so the overlapping pairs are kept up to date from the
+// swaps alone
+class sweep_and_prune
+{
+public:
+	// key must stay the same across ticks, ref is what pairs()
+	// hands back and may change every tick
+	void set(entity key, aabb const &box, std::uint32_t ref);
+	void remove(entity key);
+	void update();
+	// fn(ref, ref) for every pair overlapping on both axes
+	template <typename F>
+	void pairs(F &&fn) const;
+
+private:
+	struct object
+	{
+		aabb box;
+		entity key;
+		std::uint32_t ref;
+	};
+
+	struct endpoint
+	{
+		float at;
+		// slot << 1 | is max
+		std::uint32_t end;
+	};
+
+	// a min goes before a max at the same spot, so boxes that only
+	// touch overlap and an empty one never has its max first
+	static bool before(endpoint const &l, endpoint const &r);
+
+	static std::uint64_t pair_key(std::uint32_t a, std::uint32_t b);
+	void begin_overlap(std::uint32_t a, std::uint32_t b);
+	void end_overlap(std::uint32_t a, std::uint32_t b);
+	void purge();
+	void insert_born();
+
+	sparse_index slots_;
+	std::vector<object> objects_;
+	std::vector<std::uint32_t> free_;
+	std::vector<std::uint32_t> dead_;
+	std::vector<std::uint32_t> born_;
+	std::vector<endpoint> endpoints_;
+	std::unordered_set<std::uint64_t> overlapping_;
+};
+
+inline bool sweep_and_prune::before(endpoint const &l, endpoint const &r)
+{
+	return l.at < r.at || (l.at == r.at && (l.end & 1) < (r.end & 1));
+}
+
+inline std::uint64_t sweep_and_prune::pair_key(std::uint32_t a, std::uint32_t b)
+{
+	return static_cast<std::uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+}
+
+template <typename F>
+void sweep_and_prune::pairs(F &&fn) const
+{
+	for (const auto key : overlapping_) {
+		const auto &a = objects_[key >> 32];
+		const auto &b = objects_[key & 0xffffffff];
+		if (a.box.min.y <= b.box.max.y && b.box.min.y <= a.box.max.y)
+			fn(a.ref, b.ref);
+	}
+}
+
+} // phobos
@@ -1,6 +1,8 @@
 #pragma once
 #include "c++lib.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
+#include "job.hpp"
 #include "render.hpp"
 #include "tick.hpp"
 #include "phys.hpp"
@@ -11,35 +13,144 @@
 
 namespace phobos {
 
-#define PHOBOS_SYSTEMS(X) \
-	X(input) \
-	X(tick) \
-	X(tfms) \
-	X(dispatch) \
-	X(dispatch_timeout) \
-	X(fsm) \
-	X(dispatch_death) \
-	X(phys) \
-	X(deriv) \
-	X(hp) \
-	X(render) \
-	X(gl) \
-
-
-enum class system_id {
-#define X(name) name,
-	PHOBOS_SYSTEMS(X)
-#undef X
-	NUM
-};
-
 extern struct global_systems
 {
-#define X(name) ::phobos::name name;
-	PHOBOS_SYSTEMS(X)
-#undef X
+	::phobos::jobs jobs;
+	::phobos::input input;
+	::phobos::tick tick;
+	::phobos::tfms tfms;
+	::phobos::dispatch dispatch;
+	::phobos::dispatch_timeout dispatch_timeout;
+	::phobos::fsm fsm;
+	::phobos::dispatch_death dispatch_death;
+	::phobos::phys phys;
+	::phobos::deriv deriv;
+	::phobos::hp hp;
+	::phobos::render render;
+	::phobos::gl gl;
 } system;
 
+// a system without update() is skipped at compile time
+// and one without remove(entity) can't own components
+template <typename S>
+concept updates = requires(S s, float t) { s.update(t, t); };
+
+template <typename S>
+concept owns_components = requires(S s, entity e) { s.remove(e); };
+
+template <typename S>
+constexpr bool main_thread_only()
+{
+	if constexpr (requires { S::main_thread; })
+		return S::main_thread;
+	else
+		return false;
+}
+
+template <auto M>
+using system_of = std::remove_reference_t<decltype(system.*M)>;
+
+template <auto... M>
+struct registry
+{
+	static constexpr size_t size = sizeof...(M);
+
+	struct traits
+	{
+		system_id id;
+		bool updates;
+		bool owns_components;
+		bool main_thread;
+		std::uint64_t reads;
+		std::uint64_t writes;
+	};
+
+	static constexpr traits table[] = {
+		{
+			system_of<M>::id,
+			updates<system_of<M>>,
+			owns_components<system_of<M>>,
+			main_thread_only<system_of<M>>(),
+			system_of<M>::reads,
+			system_of<M>::writes,
+		}...
+	};
+
+	static int init();
+	static void fini();
+	static void update(float now, float dt);
+	static void update(system_id id, float now, float dt);
+	static void remove(entity e, signature sig);
+};
+
+using systems = registry<
+	&global_systems::jobs,
+	&global_systems::input,
+	&global_systems::tick,
+	&global_systems::tfms,
+	&global_systems::dispatch,
+	&global_systems::dispatch_timeout,
+	&global_systems::fsm,
+	&global_systems::dispatch_death,
+	&global_systems::phys,
+	&global_systems::deriv,
+	&global_systems::hp,
+	&global_systems::render,
+	&global_systems::gl
+>;
+
+static_assert(systems::size == static_cast<size_t>(system_id::NUM));
+static_assert([] {
+	for (size_t i = 0; i < systems::size; ++i)
+		if (systems::table[i].id != static_cast<system_id>(i))
+			return false;
+	return true;
+}(), "systems must be listed in system_id order");
+
+template <auto... M>
+int registry<M...>::init()
+{
+	int status = 0;
+	// stops at the first failure
+	(((system.*M).init() == 0 || (status = -static_cast<int>(system_of<M>::id)-1, false)) && ...);
+	return status;
+}
+
+template <auto... M>
+void registry<M...>::fini()
+{
+	((system.*M).fini(), ...);
+}
+
+template <auto... M>
+void registry<M...>::update(float now, float dt)
+{
+	([&] {
+		if constexpr (updates<system_of<M>>)
+			(system.*M).update(now, dt);
+	}(), ...);
+}
+
+template <auto... M>
+void registry<M...>::update(system_id id, float now, float dt)
+{
+	([&] {
+		if constexpr (updates<system_of<M>>)
+			if (id == system_of<M>::id)
+				(system.*M).update(now, dt);
+	}(), ...);
+}
+
+template <auto... M>
+void registry<M...>::remove(entity e, signature sig)
+{
+	([&] {
+		if constexpr (owns_components<system_of<M>>)
+			if (sig.test(static_cast<size_t>(system_of<M>::id)))
+				(system.*M).remove(e);
+	}(), ...);
+}
+
 int init();
 void fini();
 void update(float now, float dt);
@@ -48,7 +159,7 @@ void reindex(entity e, system_id sys, std::uint32_t idx);
 void add_component(entity e, system_id sys);
 void del_component(entity e, system_id sys);
 bool has_component(entity e, system_id sys);
+signature components(entity e);
 
 } // phobos
 
-
@@ -0,0 +1,54 @@
+#pragma once
+#include "c++lib.hpp"
+
+namespace phobos {
+
+// order is the update order, see `systems` in system.hpp
+enum class system_id {
+	jobs,
+	input,
+	tick,
+	tfms,
+	dispatch,
+	dispatch_timeout,
+	fsm,
+	dispatch_death,
+	phys,
+	deriv,
+	hp,
+	render,
+	gl,
+	NUM
+};
+
+// one bit per system the entity has a component in
+using signature = std::bitset<static_cast<size_t>(system_id::NUM)>;
+
+// shared state that isn't a component store
+enum class buffer {
+	collisions, // phys::colliding
+	timeouts,   // tick::timeout
+	events,     // dispatch::events
+	deaths,     // dead_this_tick(), only written between frames
+	structure,  // signatures and archetype tables, add/del_component
+	            // updates go through commands so nothing writes it
+	            // while the frame graph runs
+	NUM
+};
+
+enum : unsigned { buffer_shift = 32 };
+static_assert(static_cast<unsigned>(system_id::NUM) <= buffer_shift, "increase buffer_shift");
+
+// component stores and buffers a system's update touches
+constexpr std::uint64_t access(std::initializer_list<system_id> ids, std::initializer_list<buffer> bufs = {})
+{
+	std::uint64_t mask = 0;
+	for (const auto id : ids)
+		mask |= 1ull << static_cast<unsigned>(id);
+	for (const auto buf : bufs)
+		mask |= 1ull << (buffer_shift + static_cast<unsigned>(buf));
+	return mask;
+}
+
+} // phobos
+
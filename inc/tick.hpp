@@ -1,6 +1,7 @@
 #pragma once
 #include "c++lib.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 
 namespace phobos {
 
@@ -11,6 +12,10 @@ public:
 private:
 	std::vector<expire_in_t> expiring_;
 public:
+	static constexpr system_id id = system_id::tick;
+	static constexpr std::uint64_t reads = access({ system_id::tick });
+	static constexpr std::uint64_t writes = access({ system_id::tick }, { buffer::timeouts });
+
 	int init();
 	void fini();
 	void update(float now, float dt);
@@ -1,6 +1,7 @@
 #pragma once
 #include "c++lib.hpp"
 #include "entity.hpp"
+#include "system_id.hpp"
 #include <glm/glm.hpp>
 
 namespace phobos {
@@ -10,26 +11,102 @@ struct transform : glm::mat3x2
 	glm::vec2 &pos();
 	glm::vec2 &  x();
 	glm::vec2 &  y();
+	glm::vec2 const &pos() const;
+	glm::vec2 const &  x() const;
+	glm::vec2 const &  y() const;
 	friend transform operator*(transform l, transform r);
 
 	entity parent;
 	entity id;
 };
 
-struct tfms
+class tfms;
+
+// what referential() and modify() hand out, the lanes of one
+// entry seen as a transform, writing through it marks it dirty
+class transform_ref
+{
+public:
+	glm::vec2 &pos();
+	glm::vec2 &  x();
+	glm::vec2 &  y();
+	operator transform() const;
+	// parent is kept
+	transform_ref &operator=(glm::mat3x2 const &m);
+
+private:
+	friend tfms;
+	transform_ref(tfms *store, std::uint32_t idx);
+
+	tfms *store_;
+	std::uint32_t idx_;
+};
+
+// entries are kept in depth first order: a subtree is the
+// contiguous run [index, index + subtree size), the children of
+// an entry are the runs that follow it inside its own. a new
+// entry is appended and the order restored by the next
+// propagate() if it broke it.
+// locals and worlds are separate x, y and pos lanes in that
+// order so propagate() is a single pass, and leaves sharing a
+// parent are contiguous runs composed 8 at a time where the cpu
+// has AVX. a system writing locals calls propagate() before it
+// returns so world() is always a lookup for the systems after it
+class tfms
 {
+public:
+	static constexpr system_id id = system_id::tfms;
+	static constexpr std::uint64_t reads = access({ system_id::tfms });
+	// picks up what changed between frames
+	static constexpr std::uint64_t writes = access({ system_id::tfms });
+
 	int init();
 	void fini();
-	void update(float, float);
+	void update(float now, float dt);
+	// despawns the whole subtree
 	void remove(entity e);
 
-	std::vector<transform> data;
-
+	// a parent without a transform leaves a root behind, which
+	// stays one if the parent gets a transform later
 	void transformable(entity e, float scale, glm::vec2 offset, entity parent);
 	void transformable(entity e, transform tfm);
-	transform *referential(entity e);
-	transform world(entity e);
+	transform_ref referential(entity e);
+	transform_ref modify(std::uint32_t idx);
+	transform local(entity e) const;
+	transform world(entity e) const;
+	transform world_at(std::uint32_t idx) const;
+	void propagate();
+
+	struct lanes
+	{
+		std::vector<glm::vec2> x;
+		std::vector<glm::vec2> y;
+		std::vector<glm::vec2> pos;
+	};
+
+private:
+	friend transform_ref;
+	template <typename F>
+	void columns(F &&fn);
+	std::uint32_t parent_of(std::uint32_t idx) const;
+	void resize_ancestors(std::uint32_t idx, std::int32_t by);
+	void reindex_from(std::uint32_t idx);
+	void restore_order();
+	void compose(std::uint32_t parent, std::uint32_t begin, std::uint32_t end);
+
+	static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+	lanes local_;
+	lanes world_;
+	std::vector<entity> parent_;
+	std::vector<entity> id_;
+	// subtree size, itself included
+	std::vector<std::uint32_t> size_;
+	std::vector<std::uint8_t> dirty_;
+	std::vector<std::uint8_t> moved_;
+	// false once an entry was appended outside its parent's run,
+	// subtree sizes are stale until restore_order()
+	bool ordered_ = true;
 };
 
 } // phobos
-
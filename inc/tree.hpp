@@ -0,0 +1,155 @@
+#pragma once
+#include "c++lib.hpp"
+#include "entity.hpp"
+#include "grid.hpp"
+
+namespace phobos {
+
+// dynamic bounding volume tree: leaves hold fat boxes so an
+// object moving a little needs no update, one leaving its fat box
+// is taken out and reinserted where it grows the tree the least
+// and only its ancestors are refit
+class aabb_tree
+{
+public:
+	static constexpr std::uint32_t null = std::numeric_limits<std::uint32_t>::max();
+
+	// how much larger than the object a leaf is
+	float margin = 0.2f;
+
+	std::uint32_t insert(aabb const &box, entity e);
+	void remove(std::uint32_t leaf);
+	// true when the leaf had to be reinserted
+	bool move(std::uint32_t leaf, aabb const &box);
+	// fat box of the leaf
+	aabb const &box(std::uint32_t leaf) const;
+
+	// fn(entity) for every leaf whose fat box overlaps box
+	template <typename F>
+	void query(aabb const &box, F &&fn) const;
+	// fn(entity, max) for every leaf the segment [from, from + max * (to - from)]
+	// crosses, returns the new max so a hit can clip the rest
+	template <typename F>
+	void raycast(glm::vec2 from, glm::vec2 to, F &&fn) const;
+
+private:
+	struct node
+	{
+		aabb box;
+		// next free node when unused
+		std::uint32_t parent;
+		// both null for a leaf
+		std::uint32_t left;
+		std::uint32_t right;
+		entity e;
+	};
+
+	// traversal stack kept on the call stack, only a tree deeper
+	// than anything the insertion cost builds in practice spills
+	// the rest to the heap
+	struct walk
+	{
+		enum : std::uint32_t { depth = 64 };
+		std::uint32_t fixed[depth];
+		std::uint32_t top = 0;
+		std::vector<std::uint32_t> spill;
+
+		bool empty() const;
+		void push(std::uint32_t n);
+		std::uint32_t pop();
+	};
+
+	std::uint32_t alloc();
+	void release(std::uint32_t n);
+	void insert_leaf(std::uint32_t leaf);
+	void remove_leaf(std::uint32_t leaf);
+	void refit(std::uint32_t from);
+
+	std::vector<node> nodes_;
+	std::uint32_t root_ = null;
+	std::uint32_t free_ = null;
+};
+
+aabb merge(aabb const &a, aabb const &b);
+
+inline aabb const &aabb_tree::box(std::uint32_t leaf) const
+{
+	return nodes_[leaf].box;
+}
+
+inline bool aabb_tree::walk::empty() const
+{
+	// the spill only fills once fixed is full
+	return top == 0;
+}
+
+inline void aabb_tree::walk::push(std::uint32_t n)
+{
+	if (top < depth)
+		fixed[top++] = n;
+	else
+		spill.push_back(n);
+}
+
+inline std::uint32_t aabb_tree::walk::pop()
+{
+	if (spill.empty())
+		return fixed[--top];
+	const auto n = spill.back();
+	spill.pop_back();
+	return n;
+}
+
+template <typename F>
+void aabb_tree::query(aabb const &box, F &&fn) const
+{
+	if (root_ == null)
+		return;
+	walk stack;
+	stack.push(root_);
+	while (!stack.empty()) {
+		const auto &n = nodes_[stack.pop()];
+		if (!overlap(n.box, box))
+			continue;
+		if (n.left == null) {
+			fn(n.e);
+		} else {
+			stack.push(n.left);
+			stack.push(n.right);
+		}
+	}
+}
+
+template <typename F>
+void aabb_tree::raycast(glm::vec2 from, glm::vec2 to, F &&fn) const
+{
+	if (root_ == null)
+		return;
+	const auto d = to - from;
+	const glm::vec2 inv{ 1.0f / d.x, 1.0f / d.y };
+	float max = 1.0f;
+	// slab test, d = 0 on an axis gives infinities that still compare right
+	const auto crosses = [&] (aabb const &box)
+	{
+		const auto t0 = (box.min - from) * inv;
+		const auto t1 = (box.max - from) * inv;
+		const auto lo = std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y));
+		const auto hi = std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y));
+		return lo <= hi && hi >= 0.0f && lo <= max;
+	};
+	walk stack;
+	stack.push(root_);
+	while (!stack.empty() && max > 0.0f) {
+		const auto &n = nodes_[stack.pop()];
+		if (!crosses(n.box))
+			continue;
+		if (n.left == null) {
+			max = std::min(max, fn(n.e, max));
+		} else {
+			stack.push(n.left);
+			stack.push(n.right);
+		}
+	}
+}
+
+} // phobos
@@ -0,0 +1,119 @@
+#include "c++lib.hpp"
+#include "archetype.hpp"
+
+namespace phobos {
+
+static constexpr std::uint8_t no_slot = std::numeric_limits<std::uint8_t>::max();
+
+archetype_store &archetypes()
+{
+	static archetype_store store;
+	return store;
+}
+
+std::uint32_t *archetype_store::table::ids(std::uint32_t row) const
+{
+	return &chunks[row / chunk_rows][row % chunk_rows];
+}
+
+std::uint32_t *archetype_store::table::at(std::uint32_t row, std::uint32_t column) const
+{
+	return &chunks[row / chunk_rows][(column+1) * chunk_rows + row % chunk_rows];
+}
+
+std::uint32_t archetype_store::find(signature sig)
+{
+	if (sig.none())
+		return none;
+	const auto [it, ins] = by_signature_.emplace(sig.to_ullong(), tables_.size());
+	if (!ins)
+		return it->second;
+	auto &t = tables_.emplace_back();
+	t.sig = sig;
+	t.rows = 0;
+	t.ncolumns = 0;
+	for (size_t sys = 0; sys < std::size(t.slot); ++sys) {
+		t.slot[sys] = sig.test(sys)? t.ncolumns++: no_slot;
+		t.add[sys] = t.del[sys] = none;
+	}
+	return it->second;
+}
+
+void archetype_store::move(entity e, std::uint32_t to)
+{
+	const auto idx = entity_index(e);
+	if (idx >= where_.size())
+		where_.resize(idx+1, location{ none, 0 });
+	const auto from = where_[idx];
+
+	location dst{ to, 0 };
+	if (to != none) {
+		auto &t = tables_[to];
+		dst.row = t.rows++;
+		if (dst.row / chunk_rows == t.chunks.size())
+			t.chunks.emplace_back(std::make_unique<std::uint32_t[]>((t.ncolumns+1) * chunk_rows));
+		*t.ids(dst.row) = e;
+		for (size_t sys = 0; sys < std::size(t.slot); ++sys) {
+			if (t.slot[sys] == no_slot)
+				continue;
+			const bool kept = from.table != none && tables_[from.table].slot[sys] != no_slot;
+			*t.at(dst.row, t.slot[sys]) = kept? *tables_[from.table].at(from.row, tables_[from.table].slot[sys]): 0;
+		}
+	}
+
+	if (from.table != none) {
+		// swap and pop, the last row fills the hole
+		auto &t = tables_[from.table];
+		const std::uint32_t swapped_row = t.rows-1;
+		if (from.row != swapped_row) {
+			const entity swapped = *t.ids(swapped_row);
+			*t.ids(from.row) = swapped;
+			for (std::uint32_t col = 0; col < t.ncolumns; ++col)
+				*t.at(from.row, col) = *t.at(swapped_row, col);
+			where_[entity_index(swapped)].row = from.row;
+		}
+		--t.rows;
+		if (t.chunks.size() * chunk_rows - t.rows > chunk_rows)
+			t.chunks.pop_back();
+	}
+	where_[idx] = dst;
+}
+
+void archetype_store::add(entity e, system_id sys)
+{
+	const auto idx = entity_index(e);
+	const auto from = idx < where_.size()? where_[idx].table: none;
+	std::uint32_t to;
+	if (from == none) {
+		to = find(signature{}.set(static_cast<size_t>(sys)));
+	} else if ((to = tables_[from].add[static_cast<size_t>(sys)]) == none) {
+		to = find(signature{tables_[from].sig}.set(static_cast<size_t>(sys)));
+		tables_[from].add[static_cast<size_t>(sys)] = to;
+	}
+	move(e, to);
+}
+
+void archetype_store::del(entity e, system_id sys)
+{
+	const auto from = where_[entity_index(e)].table;
+	assert(from != none);
+	auto to = tables_[from].del[static_cast<size_t>(sys)];
+	if (to == none) {
+		to = find(signature{tables_[from].sig}.reset(static_cast<size_t>(sys)));
+		// the empty signature has no table, so it is looked up every time
+		tables_[from].del[static_cast<size_t>(sys)] = to;
+	}
+	move(e, to);
+}
+
+void archetype_store::set(entity e, system_id sys, std::uint32_t idx)
+{
+	const auto at = where_[entity_index(e)];
+	assert(at.table != none);
+	const auto &t = tables_[at.table];
+	assert(t.slot[static_cast<size_t>(sys)] != no_slot);
+	*t.at(at.row, t.slot[static_cast<size_t>(sys)]) = idx;
+}
+
+} // phobos
+
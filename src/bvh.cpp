@@ -0,0 +1,114 @@
+#include "c++lib.hpp"
+#include "bvh.hpp"
+
+namespace phobos {
+
+void edge_bvh::build(std::vector<glm::vec2> const &loop)
+{
+	edges_.clear();
+	nodes_.clear();
+	if (loop.size() < 2)
+		return;
+	edges_.reserve(loop.size());
+	for (size_t i = 0; i < loop.size(); ++i)
+		edges_.push_back({ loop[i], loop[(i+1) % loop.size()] });
+	nodes_.reserve(2 * (edges_.size() / leaf_edges + 1));
+	build(0, edges_.size(), 0);
+}
+
+std::uint32_t edge_bvh::build(std::uint32_t begin, std::uint32_t end, std::uint32_t depth)
+{
+	const std::uint32_t at = nodes_.size();
+	nodes_.emplace_back();
+	aabb box{ edges_[begin].from, edges_[begin].from };
+	aabb centers = box;
+	for (auto e = begin; e < end; ++e) {
+		const auto &[from, to] = edges_[e];
+		box.min = glm::min(box.min, glm::min(from, to));
+		box.max = glm::max(box.max, glm::max(from, to));
+		const auto center = 0.5f * (from + to);
+		centers.min = glm::min(centers.min, center);
+		centers.max = glm::max(centers.max, center);
+	}
+	nodes_[at].box = box;
+	// a query pushes both children, so the stack needs two per level
+	if (end - begin <= leaf_edges || 2 * depth + 2 >= max_depth) {
+		nodes_[at].at = begin;
+		nodes_[at].count = end - begin;
+		return at;
+	}
+
+	// median of the centers along the wider axis
+	const auto extent = centers.max - centers.min;
+	const int axis = extent.x < extent.y;
+	const auto mid = begin + (end - begin) / 2;
+	std::nth_element(std::begin(edges_) + begin, std::begin(edges_) + mid, std::begin(edges_) + end,
+		[axis] (edge const &l, edge const &r)
+		{
+			return (l.from[axis] + l.to[axis]) < (r.from[axis] + r.to[axis]);
+		});
+	build(begin, mid, depth+1);
+	const auto right = build(mid, end, depth+1);
+	nodes_[at].at = right;
+	nodes_[at].count = 0;
+	return at;
+}
+
+static float segment_dist2(glm::vec2 p, glm::vec2 from, glm::vec2 to)
+{
+	const auto s = to - from, d = p - from;
+	const auto ss = glm::dot(s, s);
+	const auto t = ss > 0.0f? std::clamp(glm::dot(d, s) / ss, 0.0f, 1.0f): 0.0f;
+	const auto e = d - s * t;
+	return glm::dot(e, e);
+}
+
+static float box_dist2(aabb const &box, glm::vec2 p)
+{
+	const auto d = glm::max(glm::max(box.min - p, p - box.max), glm::vec2{ 0.0f, 0.0f });
+	return glm::dot(d, d);
+}
+
+float edge_bvh::nearest2(glm::vec2 p) const
+{
+	auto best = std::numeric_limits<float>::infinity();
+	if (nodes_.empty())
+		return best;
+	std::uint32_t stack[max_depth];
+	std::uint32_t top = 0;
+	stack[top++] = 0;
+	while (top) {
+		const auto &n = nodes_[stack[--top]];
+		if (box_dist2(n.box, p) >= best)
+			continue;
+		if (n.count) {
+			for (auto e = n.at; e < n.at + n.count; ++e)
+				best = std::min(best, segment_dist2(p, edges_[e].from, edges_[e].to));
+			continue;
+		}
+		// the closer child goes on top
+		const std::uint32_t left = &n - nodes_.data() + 1, right = n.at;
+		const bool left_first = box_dist2(nodes_[left].box, p) <= box_dist2(nodes_[right].box, p);
+		stack[top++] = left_first? right: left;
+		stack[top++] = left_first? left: right;
+	}
+	return best;
+}
+
+bool edge_bvh::inside(glm::vec2 p) const
+{
+	// edges crossed by the half line going right from p
+	bool in = false;
+	const aabb right{ p, { std::numeric_limits<float>::max(), p.y } };
+	query(right, [&] (glm::vec2 from, glm::vec2 swept)
+	{
+		const auto to = from + swept;
+		if ((from.y > p.y) != (to.y > p.y)
+		 && p.x < from.x + (p.y - from.y) / swept.y * swept.x)
+			in = !in;
+		return false;
+	});
+	return in;
+}
+
+} // phobos
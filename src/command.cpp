@@ -0,0 +1,119 @@
+#include "c++lib.hpp"
+#include "command.hpp"
+#include "system.hpp"
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace phobos {
+
+static std::unique_ptr<commands[]> g_buffers;
+static unsigned g_threads = 0;
+// outside of any update, replayed last
+static thread_local commands::origin t_recording = { system_id::NUM, 0 };
+
+void commands::init(unsigned threads)
+{
+	assert(threads);
+	g_buffers = std::make_unique<commands[]>(threads);
+	g_threads = threads;
+	for (unsigned t = 0; t < threads; ++t) {
+		auto &block = g_buffers[t].block_;
+		block.resize(block_size);
+		spawn_block(block.data(), block_size);
+	}
+}
+
+commands &commands::local()
+{
+	assert(jobs::self() < g_threads);
+	return g_buffers[jobs::self()];
+}
+
+commands::origin commands::recording()
+{
+	return t_recording;
+}
+
+commands::origin commands::recording(origin at)
+{
+	return std::exchange(t_recording, at);
+}
+
+std::uint64_t commands::fork(std::uint32_t count)
+{
+	const auto first = t_recording.order + 1;
+	t_recording.order += count + 1;
+	return first;
+}
+
+entity commands::spawn()
+{
+	if (block_.empty()) {
+		// more spawns than a block in one frame, only then contend
+		block_.resize(block_size);
+		spawn_block(block_.data(), block_size);
+	}
+	const auto e = block_.back();
+	block_.pop_back();
+	return e;
+}
+
+void commands::add(entity e, system_id sys, std::function<void()> attach)
+{
+	commands_.push_back(command{ command::add_op, t_recording, sys, e, std::move(attach) });
+}
+
+void commands::remove(entity e, system_id sys)
+{
+	commands_.push_back(command{ command::remove_op, t_recording, sys, e, {} });
+}
+
+void commands::despawn(entity e)
+{
+	commands_.push_back(command{ command::despawn_op, t_recording, system_id::NUM, e, {} });
+}
+
+void commands::flush()
+{
+	static std::vector<command*> order;
+	order.clear();
+	for (unsigned t = 0; t < g_threads; ++t)
+		for (auto &cmd : g_buffers[t].commands_)
+			order.push_back(&cmd);
+	// a task runs on one thread, stable keeps its recording order
+	std::stable_sort(std::begin(order), std::end(order), [] (command const *a, command const *b)
+	{
+		return std::tie(a->from.by, a->from.order) < std::tie(b->from.by, b->from.order);
+	});
+
+	for (const auto cmd : order) {
+		switch (cmd->kind) {
+		case command::add_op:
+			// despawned by an earlier flush
+			if (alive(cmd->e))
+				cmd->attach();
+			break;
+		case command::remove_op:
+			if (has_component(cmd->e, cmd->sys))
+				systems::remove(cmd->e, signature{}.set(static_cast<size_t>(cmd->sys)));
+			break;
+		case command::despawn_op:
+			phobos::despawn(cmd->e);
+			break;
+		}
+	}
+
+	for (unsigned t = 0; t < g_threads; ++t) {
+		auto &buf = g_buffers[t];
+		buf.commands_.clear();
+		const auto used = block_size - std::min<std::uint32_t>(buf.block_.size(), block_size);
+		if (!used)
+			continue;
+		const auto kept = buf.block_.size();
+		buf.block_.resize(kept + used);
+		spawn_block(buf.block_.data() + kept, used);
+	}
+}
+
+} // phobos
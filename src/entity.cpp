@@ -1,43 +1,103 @@
 #include "c++lib.hpp"
 #include "entity.hpp"
 #include "system.hpp"
+#include "sparse.hpp"
+#include <atomic>
+#include <deque>
+#include <mutex>
 
 namespace phobos {
 
-static entity g_cur;
-std::unordered_map<entity, std::uint32_t> g_entity_mapping[static_cast<size_t>(system_id::NUM)];
+// paged so a spawn from a worker never moves what alive() reads
+static paged_array<std::uint32_t, entity_index_bits> g_generation;
+// FIFO so a freed index waits as long as possible before
+// being reused, which keeps generation wraparound unlikely
+static std::deque<std::uint32_t> g_free;
+// index 0 is the null handle, never handed out. the first index
+// never handed out either, read by alive() without the lock
+static std::atomic<std::uint32_t> g_top = 1;
+static std::mutex g_spawn_lock;
+paged_array<signature, entity_index_bits> g_signature;
+sparse_index g_entity_mapping[static_cast<size_t>(system_id::NUM)];
 static std::vector<entity> g_on_hold;
+static std::vector<entity> g_dead;
 
 const std::vector<entity> &dead_this_tick()
 {
-	return g_on_hold;
+	return g_dead;
+}
+
+// g_spawn_lock held
+static entity take()
+{
+	std::uint32_t idx;
+	if (!g_free.empty()) {
+		idx = g_free.front();
+		g_free.pop_front();
+	} else {
+		idx = g_top.load(std::memory_order_relaxed);
+		assert(idx <= entity_index_mask);
+		g_generation.ensure(idx);
+		g_signature.ensure(idx);
+		// published once its pages are there
+		g_top.store(idx+1, std::memory_order_release);
+	}
+	return g_generation[idx] << entity_index_bits | idx;
 }
 
 entity spawn()
 {
-	return ++g_cur;
+	std::lock_guard lk{g_spawn_lock};
+	return take();
+}
+
+void spawn_block(entity *out, std::uint32_t n)
+{
+	std::lock_guard lk{g_spawn_lock};
+	for (std::uint32_t i = 0; i < n; ++i)
+		out[i] = take();
+}
+
+bool alive(entity e)
+{
+	const auto idx = entity_index(e);
+	const auto gen = g_generation.find(idx);
+	// an index past g_top can share a page with live ones and
+	// read generation 0, so a forged handle would look alive
+	return idx && idx < g_top.load(std::memory_order_acquire) && gen && *gen == entity_generation(e);
+}
+
+static void release(entity e)
+{
+	const auto idx = entity_index(e);
+	std::lock_guard lk{g_spawn_lock};
+	g_generation[idx] = (g_generation[idx]+1) & entity_generation_mask;
+	g_free.push_back(idx);
 }
 
 void despawn(entity e)
 {
-	assert(e);
+	// stale handles (already recycled) and null are ignored
+	if (!alive(e))
+		return;
 	g_on_hold.push_back(e);
 }
 
 void update()
 {
+	g_dead.clear();
 	// updates during the loop
 	for (size_t i = 0; i < g_on_hold.size(); ++i) {
 		const auto e = g_on_hold[i];
-#define X(name) if (has_component(e, system_id::name)) system.name.remove(e);
-		PHOBOS_SYSTEMS(X)
-#undef X
-		for (size_t type = 0; type < std::size(g_entity_mapping); ++type) {
-			g_entity_mapping[type].erase(e);
-		}
+		// despawned twice in the same tick
+		if (!alive(e))
+			continue;
+		systems::remove(e, components(e));
+		assert(components(e).none());
+		release(e);
+		g_dead.push_back(e);
 	}
 	g_on_hold.clear();
 }
 
 } // phobos
-
@@ -1,4 +1,6 @@
 #include "system.hpp"
+#include "archetype.hpp"
+#include "command.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 
@@ -50,22 +52,24 @@ static entity spawn_slash(glm::vec2 dir, entity from)
 	const glm::vec2 x{1.0f, 0.0f};
 	const glm::vec2 y{0.0f, 1.0f};
 
-	const auto hand = spawn();
-	system.tfms.transformable(hand, {{x, y, at}, from});
-	const auto cone = spawn();
-	system.render.drawable(cone, render::attack_cone);
-	system.tfms.transformable(cone, {{swing, swing_tail, zero}, hand});
-	const auto cone_speed = spawn();
-	system.tfms.transformable(cone_speed, {{{0.0f, windspeed}, {-windspeed, 0.0f}, zero}, 0});
-	system.deriv.deriv_from(cone, cone_speed);
-	system.phys.collider_triangle(cone);
-	const auto trail = spawn();
-	system.tfms.transformable(trail, {});
-	system.render.trailable(trail, cone);
-
-	system.fsm.make_slash(hand, cone, cone_speed, trail);
-	system.dispatch_timeout.listen(hand);
-	system.tick.wait(hand, 0.2f);
+	// recorded, the slash only exists from the next flush on
+	auto &cmd = commands::local();
+	const auto hand = cmd.spawn();
+	const auto cone = cmd.spawn();
+	const auto cone_speed = cmd.spawn();
+	const auto trail = cmd.spawn();
+	cmd.add(hand, system_id::tfms, [=] { system.tfms.transformable(hand, {{x, y, at}, from}); });
+	cmd.add(cone, system_id::render, [=] { system.render.drawable(cone, render::attack_cone); });
+	cmd.add(cone, system_id::tfms, [=] { system.tfms.transformable(cone, {{swing, swing_tail, zero}, hand}); });
+	cmd.add(cone_speed, system_id::tfms, [=] { system.tfms.transformable(cone_speed, {{{0.0f, windspeed}, {-windspeed, 0.0f}, zero}, 0}); });
+	cmd.add(cone, system_id::deriv, [=] { system.deriv.deriv_from(cone, cone_speed); });
+	cmd.add(cone, system_id::phys, [=] { system.phys.collider_triangle(cone); });
+	cmd.add(trail, system_id::tfms, [=] { system.tfms.transformable(trail, {}); });
+	cmd.add(trail, system_id::render, [=] { system.render.trailable(trail, cone); });
+
+	cmd.add(hand, system_id::fsm, [=] { system.fsm.make_slash(hand, cone, cone_speed, trail); });
+	cmd.add(hand, system_id::dispatch_timeout, [=] { system.dispatch_timeout.listen(hand); });
+	cmd.add(hand, system_id::tick, [=] { system.tick.wait(hand, 0.2f); });
 	return hand;
 }
 
@@ -106,15 +110,18 @@ next:   switch (sm.state) {
 			sm.state = fsm::combat_attack;
 			const auto en_pos = system.tfms.world(sm.id).pos();
 			const auto diff = pl_pos - en_pos;
-			const auto slash = spawn_slash(glm::normalize(diff), sm.id);
-			system.dispatch_death.listen(sm.id, slash);
+			sm.slash = spawn_slash(glm::normalize(diff), sm.id);
+			const auto id = sm.id, slash = sm.slash;
+			commands::local().add(id, system_id::dispatch_death, [=] { system.dispatch_death.listen(id, slash); });
 		}
 		break;
 	case fsm::combat_attack:
 		if (bit_test(ev_mask, fsm::die)) {
 			sm.state = fsm::combat_attack_cooldown;
-			system.dispatch_death.remove(sm.id);
-			system.tick.wait(sm.id, 0.5f);
+			const auto id = sm.id;
+			auto &cmd = commands::local();
+			cmd.remove(id, system_id::dispatch_death);
+			cmd.add(id, system_id::tick, [=] { system.tick.wait(id, 0.5f); });
 			sm.slash = 0;
 		}
 		break;
@@ -135,16 +142,16 @@ static void transition(fsm::slash_t &sm, std::uint32_t ev_mask)
 		if (bit_test(ev_mask, fsm::timeout)) {
 			sm.state = fsm::idle;
 			const auto speed = 7.0f;
-			const auto tfm = system.tfms.referential(sm.speed);
-			assert(tfm);
-			tfm->x().y = speed;
-			tfm->y().x = -speed;
-			system.tick.wait(sm.id, 0.8f);
+			auto tfm = system.tfms.referential(sm.speed);
+			tfm.x().y = speed;
+			tfm.y().x = -speed;
+			const auto id = sm.id;
+			commands::local().add(id, system_id::tick, [=] { system.tick.wait(id, 0.8f); });
 		}
 		break;
 	case fsm::idle:
 		if (bit_test(ev_mask, fsm::timeout)) {
-			despawn(sm.id);
+			commands::local().despawn(sm.id);
 		}
 		break;
 	default: assert(false);
@@ -154,6 +161,25 @@ static void transition(fsm::slash_t &sm, std::uint32_t ev_mask)
 void fsm::update(float, float dt)
 {
 	const auto pl_pos = system.tfms.world(player).pos();
+	auto &enemies = fsms[enemy_dumb0].enemy_dumb0;
+
+	// ranges are queried instead of being colliders of their own
+	static std::vector<std::uint32_t> masks;
+	masks.assign(enemies.size(), 0);
+	for (size_t i = 0; i < enemies.size(); ++i) {
+		const auto tfm = system.tfms.world(enemies[i].id);
+		const auto sees = [&] (float range, event_t ev)
+		{
+			system.phys.query_circle(tfm.pos(), range * tfm.x().x * 0.5f, [&] (entity e)
+			{
+				if (e == player)
+					masks[i] |= 1u << ev;
+			}, phys::body);
+		};
+		sees(enemies[i].fight_range, collide_fight_range);
+		sees(enemies[i].sight_range, collide_sight_range);
+	}
+
 	// TODO: sort events somehow to avoid the switch
 	for (size_t cidx = 0; cidx < system.dispatch.events.size(); ++cidx) {
 		const auto event = system.dispatch.events[cidx];
@@ -163,33 +189,46 @@ void fsm::update(float, float dt)
 		auto &fsms = this->fsms[type_idx];
 		switch (type_idx) {
 		case enemy_dumb0:
-			transition(fsms.enemy_dumb0[fsm_idx], event.payload, pl_pos);
+			masks[fsm_idx] |= event.payload;
 			break;
 		case slash:
 			transition(fsms.slash[fsm_idx], event.payload);
 			break;
 		}
 	}
-
-	for (const auto &e : fsms[enemy_dumb0].enemy_dumb0) {
+	for (size_t i = 0; i < enemies.size(); ++i)
+		transition(enemies[i], masks[i], pl_pos);
+
+	static view<system_id::tfms, system_id::fsm> moving;
+	// enemies are roots so moving one never changes another's world
+	moving.par_each([&] (entity, std::uint32_t tfm_idx, std::uint32_t fsm_idx)
+	{
+		if ((fsm_idx & type_mask) != enemy_dumb0)
+			return;
+		const auto &e = fsms[enemy_dumb0].enemy_dumb0[fsm_idx >> type_shift];
 		if (e.state == fsm::move) {
-			const auto en_pos = system.tfms.world(e.id).pos();
+			const auto en_pos = system.tfms.world_at(tfm_idx).pos();
 			const auto diff = pl_pos - en_pos;
 			const float speed = 1.5f;
-			system.tfms.referential(e.id)->pos() += dt * speed * glm::normalize(diff);
+			system.tfms.modify(tfm_idx).pos() += dt * speed * glm::normalize(diff);
 		}
-	}
+	});
+	system.tfms.propagate();
 }
 
 void fsm::make_enemy_dumb0(entity e)
 {
 	const std::uint32_t type_idx = static_cast<std::uint32_t>(type::enemy_dumb0);
 	const std::uint32_t idx = type_idx | fsms[enemy_dumb0].enemy_dumb0.size() << type_shift;
-	const auto fight_range = spawn();
-	const auto sight_range = spawn();
+	const auto range =
+		+ 0.5f  // player radius
+		+ 0.25f // enemy radius
+		+ 0.6f  // enemy slash size
+		- 0.1f  // margin
+	;
 	enemy_dumb0_t repr{
 		{ e, fsm::just_spawned },
-		fight_range, sight_range, 0,
+		range, 5.0f, 0,
 	};
 	fsms[enemy_dumb0].enemy_dumb0.push_back(repr);
 	add_component(e, system_id::fsm);
@@ -197,24 +236,6 @@ void fsm::make_enemy_dumb0(entity e)
 	system.dispatch_timeout.listen(e);
 	system.tick.wait(e, 1.0f); // initial value
 	system.dispatch.listen_collision(e, e, 0, 1u << fsm::collide_any);
-
-	const auto range =
-		+ 0.5f  // player radius
-		+ 0.25f // enemy radius
-		+ 0.6f  // enemy slash size
-		- 0.1f  // margin
-	;
-
-	system.tfms.transformable(fight_range, range, glm::vec2{0.0f, 0.0f}, e);
-	system.phys.collider_circle(fight_range);
-	system.dispatch.listen_collision(e, fight_range, player, 1u << fsm::collide_fight_range);
-	// system.render.drawable(fight_range, render::aggro);
-
-	system.tfms.transformable(sight_range, 5.0f, glm::vec2{0.0f, 0.0f}, e);
-	system.phys.collider_circle(sight_range);
-	system.dispatch.listen_collision(e, sight_range, player, 1u << fsm::collide_sight_range);
-	// system.render.drawable(sight_range, render::aggro);
-
 }
 
 void fsm::make_player(entity e)
@@ -231,16 +252,14 @@ void fsm::remove(entity e)
 	switch (type_idx) {
 		std::uint32_t swapped_idx;
 	case enemy_dumb0:
-		despawn(fsms.enemy_dumb0[removed_idx].fight_range);
-		despawn(fsms.enemy_dumb0[removed_idx].sight_range);
-		despawn(fsms.enemy_dumb0[removed_idx].slash      );
+		// the slash is a transform child, gone with e
 		swapped_idx = fsms.enemy_dumb0.size()-1;
 		fsms.enemy_dumb0[removed_idx] = fsms.enemy_dumb0[swapped_idx];
 		reindex(fsms.enemy_dumb0[removed_idx].id, system_id::fsm, idx);
 		fsms.enemy_dumb0.pop_back();
 		break;
 	case slash:
-		despawn(fsms.slash[removed_idx].cone );
+		// the cone hangs off e, speed and trail are roots
 		despawn(fsms.slash[removed_idx].speed);
 		despawn(fsms.slash[removed_idx].trail);
 		swapped_idx = fsms.slash.size()-1;
@@ -264,31 +283,23 @@ void dispatch::fini()
 
 void dispatch::update(float, float)
 {
-	// TODO: sort arrays for more efficient access
-	//  O(N2*M) -> O(NlogN + MlogM + max(N,M))
-	//  with N = # colliding and M = # listening
+	// only collisions that just started are events, each
+	// listener looks up the ones of its entity
 	//
-	//  FIXME: collisions should be consumed once seen
-	//  and wildcards should be tested last
-	for (size_t i = 0; i < system.phys.colliding.size(); ++i) {
-		const auto cur = system.phys.colliding[i];
-		const auto begin = std::cbegin(listening_collision);
-		const auto end   = std::cend  (listening_collision);
-		const auto match = [=] (auto elem)
-		{
-			return elem.e == cur.main && (elem.with == cur.other || !elem.with);
-		};
-		const auto find = std::find_if(begin, end, match);
-		if (find == end)
+	// FIXME: wildcards should be tested last
+	for (const auto &l : listening_collision) {
+		const auto began = system.phys.began_by.of(l.e);
+		const auto match = [=] (auto elem) { return !l.with || elem.other == l.with; };
+		if (std::none_of(std::begin(began), std::end(began), match))
 			continue;
 
 		const auto col_b = std::begin(events);
 		const auto col_e = std::end  (events);
-		const auto col_i = std::find_if(col_b, col_e, [=] (auto elem) { return elem.listen == find->listen; });
+		const auto col_i = std::find_if(col_b, col_e, [=] (auto elem) { return elem.listen == l.listen; });
 		if (col_i == col_e) {
-			events.emplace_back(find->listen, find->payload);
+			events.emplace_back(l.listen, l.payload);
 		} else {
-			col_i->payload |= find->payload;
+			col_i->payload |= l.payload;
 		}
 	}
 }
@@ -297,6 +308,7 @@ void dispatch::remove(entity e)
 {
 	const std::uint32_t idx = index(e, system_id::dispatch);
 	const std::uint32_t swapped_idx = listening_collision.size()-1;
+	system.phys.unsubscribe(listening_collision[idx].e, listening_collision[idx].with);
 	listening_collision[idx] = listening_collision[swapped_idx];
 	reindex(listening_collision[idx].e, system_id::dispatch, idx);
 	del_component(e, system_id::dispatch);
@@ -306,6 +318,7 @@ void dispatch::remove(entity e)
 void dispatch::listen_collision(entity listen, entity e, entity with, std::uint32_t payload)
 {
 	listening_collision.emplace_back(listen, e, with, payload);
+	system.phys.subscribe(e, with);
 	add_component(e, system_id::dispatch);
 	reindex(e, system_id::dispatch, listening_collision.size()-1);
 }
@@ -0,0 +1,54 @@
+#include "c++lib.hpp"
+#include "grid.hpp"
+
+namespace phobos {
+
+void grid::clear()
+{
+	boxes_.clear();
+	refs_.clear();
+	big_.clear();
+	bigs_.clear();
+	pending_.clear();
+}
+
+void grid::insert(aabb const &box, std::uint32_t ref)
+{
+	const std::uint32_t obj = boxes_.size();
+	boxes_.push_back(box);
+	refs_.push_back(ref);
+	const auto x0 = cell(box.min.x), x1 = cell(box.max.x);
+	const auto y0 = cell(box.min.y), y1 = cell(box.max.y);
+	const bool big = x1 - x0 >= max_span || y1 - y0 >= max_span;
+	big_.push_back(big);
+	if (big) {
+		bigs_.push_back(obj);
+		return;
+	}
+	for (auto y = y0; y <= y1; ++y)
+		for (auto x = x0; x <= x1; ++x)
+			pending_.push_back(entry{ x, y, obj });
+}
+
+void grid::build()
+{
+	// about two buckets per entry keeps unrelated cells apart
+	std::uint32_t buckets = 1;
+	while (buckets < 2 * pending_.size())
+		buckets <<= 1;
+	mask_ = buckets-1;
+
+	// counting sort by bucket
+	starts_.assign(buckets+1, 0);
+	for (const auto &e : pending_)
+		++starts_[bucket(e.x, e.y)+1];
+	for (std::uint32_t b = 0; b < buckets; ++b)
+		starts_[b+1] += starts_[b];
+	entries_.resize(pending_.size());
+	static std::vector<std::uint32_t> at;
+	at.assign(std::begin(starts_), std::end(starts_)-1);
+	for (const auto &e : pending_)
+		entries_[at[bucket(e.x, e.y)]++] = e;
+}
+
+} // phobos
@@ -84,10 +84,6 @@ void gl::fini()
 	system.input.win.fini();
 }
 
-void gl::update(float, float)
-{
-}
-
 void input::update(float, float)
 {
 	pressed_state.reset();
@@ -103,13 +99,5 @@ bool input::pressed(key k) const
 	return pressed_state.test(static_cast<size_t>(k));
 }
 
-void input::remove(std::uint32_t)
-{
-}
-
-void gl::remove(entity)
-{
-}
-
 } // phobos
 
@@ -0,0 +1,244 @@
+#include "c++lib.hpp"
+#include "job.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace phobos {
+
+static thread_local unsigned t_self = 0;
+
+// pins the calling thread
+static void pin(unsigned cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof set, &set) != 0)
+		std::print("[JOB] Failed to pin thread to cpu {}\n", cpu);
+#else
+	(void) cpu;
+#endif
+}
+
+int jobs::init()
+{
+	if (const auto env = std::getenv("PHOBOS_WORKERS")) {
+		// signed, so -1 doesn't wrap into billions of threads
+		char *end;
+		const auto n = std::strtol(env, &end, 10);
+		if (end != env && !*end && n > 0 && n < automatic)
+			worker_count = n;
+		else
+			std::print("[JOB] Ignoring PHOBOS_WORKERS={}, expected a positive count\n", env);
+	}
+	if (const auto env = std::getenv("PHOBOS_PIN"))
+		pinned = std::atoi(env) != 0;
+	if (worker_count == automatic)
+		worker_count = std::max(1u, std::thread::hardware_concurrency());
+	worker_count = std::max(1u, worker_count);
+
+	queued_ = 0;
+	quit_ = false;
+	workers_ = std::make_unique<worker[]>(worker_count);
+	if (pinned)
+		pin(0);
+	for (unsigned self = 1; self < worker_count; ++self)
+		threads_.emplace_back([this, self] { loop(self); });
+	return 0;
+}
+
+void jobs::fini()
+{
+	{
+		std::lock_guard lk{sleep_lock_};
+		quit_ = true;
+	}
+	sleep_.notify_all();
+	for (auto &thread : threads_)
+		thread.join();
+	threads_.clear();
+}
+
+unsigned jobs::size() const
+{
+	// threads_ is still growing while the first workers start
+	return worker_count;
+}
+
+unsigned jobs::self()
+{
+	return t_self;
+}
+
+void jobs::push(task const &t)
+{
+	++queued_;
+	{
+		std::lock_guard lk{workers_[t_self].lock};
+		workers_[t_self].queue.push_back(t);
+	}
+	{
+		// a worker checking queued_ either sees it or is already waiting
+		std::lock_guard lk{sleep_lock_};
+	}
+	sleep_.notify_one();
+}
+
+void jobs::push_main(task const &t)
+{
+	// worker 0 polls while it waits, no need to wake anyone
+	std::lock_guard lk{workers_[0].lock};
+	workers_[0].pinned.push_back(t);
+}
+
+bool jobs::pop(task *t)
+{
+	auto &self = workers_[t_self];
+	std::lock_guard lk{self.lock};
+	if (!self.pinned.empty()) {
+		*t = self.pinned.front();
+		self.pinned.pop_front();
+		return true;
+	}
+	if (self.queue.empty())
+		return false;
+	*t = self.queue.back();
+	self.queue.pop_back();
+	--queued_;
+	return true;
+}
+
+bool jobs::steal(task *t)
+{
+	const unsigned n = size();
+	std::vector<task> stolen;
+	for (unsigned k = 1; k < n; ++k) {
+		auto &victim = workers_[(t_self + k) % n];
+		{
+			std::lock_guard lk{victim.lock};
+			if (victim.queue.empty())
+				continue;
+			// oldest half, which tends to be the biggest ranges
+			const auto half = (victim.queue.size() + 1) / 2;
+			const auto first = std::begin(victim.queue);
+			stolen.assign(first, first + half);
+			victim.queue.erase(first, first + half);
+		}
+		*t = stolen.back();
+		stolen.pop_back();
+		--queued_;
+		if (!stolen.empty()) {
+			auto &self = workers_[t_self];
+			std::lock_guard lk{self.lock};
+			self.queue.insert(std::end(self.queue), std::begin(stolen), std::end(stolen));
+		}
+		return true;
+	}
+	return false;
+}
+
+void jobs::execute(task const &t)
+{
+	const auto outer = commands::recording(t.from);
+	t.fn(t.ctx, t.begin, t.end);
+	commands::recording(outer);
+	t.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void jobs::wait(std::atomic<std::uint32_t> const &pending)
+{
+	task t;
+	while (pending.load(std::memory_order_acquire)) {
+		if (pop(&t) || steal(&t))
+			execute(t);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void jobs::loop(unsigned self)
+{
+	t_self = self;
+	if (pinned)
+		pin(self);
+	task t;
+	while (!quit_) {
+		if (pop(&t) || steal(&t)) {
+			execute(t);
+			continue;
+		}
+		std::unique_lock lk{sleep_lock_};
+		sleep_.wait(lk, [this] { return queued_ || quit_; });
+	}
+}
+
+std::uint32_t jobs::graph::add(std::function<void()> fn, bool main_thread)
+{
+	auto &n = nodes_.emplace_back();
+	n.fn = std::move(fn);
+	n.deps = 0;
+	n.main_thread = main_thread;
+	return nodes_.size()-1;
+}
+
+void jobs::graph::depend(std::uint32_t before, std::uint32_t after)
+{
+	nodes_[before].next.push_back(after);
+	++nodes_[after].deps;
+}
+
+void jobs::graph::clear()
+{
+	nodes_.clear();
+}
+
+size_t jobs::graph::size() const
+{
+	return nodes_.size();
+}
+
+void jobs::run_node(void *ctx, std::uint32_t node, std::uint32_t)
+{
+	auto &g = *static_cast<graph*>(ctx);
+	auto &n = g.nodes_[node];
+	n.fn();
+	for (const auto next : n.next) {
+		if (g.nodes_[next].waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			// successors share the pending counter of the whole graph,
+			// and nodes set the system they record for themselves
+			const task t{ run_node, ctx, next, next+1, g.pending_, { system_id::NUM, 0 } };
+			if (g.nodes_[next].main_thread)
+				g.pool_->push_main(t);
+			else
+				g.pool_->push(t);
+		}
+	}
+}
+
+void jobs::run(graph &g)
+{
+	if (g.nodes_.empty())
+		return;
+	// only the main thread ever picks up main_thread nodes
+	assert(t_self == 0);
+	std::atomic<std::uint32_t> pending = g.nodes_.size();
+	g.pending_ = &pending;
+	g.pool_ = this;
+	for (auto &n : g.nodes_)
+		n.waiting = n.deps;
+	for (std::uint32_t i = 0; i < g.nodes_.size(); ++i) {
+		if (g.nodes_[i].deps)
+			continue;
+		const task t{ run_node, &g, i, i+1, &pending, { system_id::NUM, 0 } };
+		if (g.nodes_[i].main_thread)
+			push_main(t);
+		else
+			push(t);
+	}
+	wait(pending);
+}
+
+} // phobos
+
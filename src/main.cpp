@@ -79,8 +79,8 @@ phobos::entity player_control(phobos::entity attack, phobos::entity player, floa
 	if (glm::length2(offset) > 0.5f) {
 		const auto speed = 2.5f;
 		offset = dt * speed * glm::normalize(offset);
-		const auto tfm = ng.tfms.referential(player);
-		tfm->pos() += offset;
+		auto tfm = ng.tfms.referential(player);
+		tfm.pos() += offset;
 		ng.render.camera_pos -= offset;
 	}
 	if (ng.input.pressed(phobos::key::K_F) && (!attack || !phobos::has_component(attack, phobos::system_id::tick)))
@@ -129,7 +129,8 @@ int main()
 		prev_time = now;
 		win_control(ng.input.win);
 		attack = player_control(attack, player, dt);
-		std::print("\rframe time: {:#4.1f}ms fps: {:#3.1f}s-1         ", dt * 1e3, 1.0f / dt);
+		std::print("\rframe time: {:#4.1f}ms fps: {:#3.1f}s-1 pairs: {} tested {} skipped colliders: {} awake {} sleeping         ",
+			dt * 1e3, 1.0f / dt, ng.phys.tested, ng.phys.skipped, ng.phys.awake, ng.phys.sleeping);
 		phobos::update(now, dt);
 		ng.input.win.draw();
 	}
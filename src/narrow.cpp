@@ -0,0 +1,220 @@
+#include "c++lib.hpp"
+#include "narrow.hpp"
+#include "phys.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace phobos {
+
+using circle_circle_fn = std::uint32_t (*)(circle_block const &, circle_block const &, std::uint32_t);
+using circle_ray_fn = std::uint32_t (*)(circle_block const &, ray_block const &, std::uint32_t);
+using circle_triangle_fn = std::uint32_t (*)(circle_block const &, triangle_block const &, std::uint32_t);
+
+static circle lane(circle_block const &b, std::uint32_t i)
+{
+	return { { b.x[i], b.y[i] }, b.r[i] };
+}
+
+static ray lane(ray_block const &b, std::uint32_t i)
+{
+	return { { b.ox[i], b.oy[i] }, { b.sx[i], b.sy[i] } };
+}
+
+static triangle lane(triangle_block const &b, std::uint32_t i)
+{
+	return { { b.ox[i], b.oy[i] }, { b.ux[i], b.uy[i] }, { b.vx[i], b.vy[i] } };
+}
+
+template <typename L, typename R>
+static std::uint32_t test_scalar(L const &l, R const &r, std::uint32_t n)
+{
+	std::uint32_t hits = 0;
+	for (std::uint32_t i = 0; i < n; ++i)
+		hits |= std::uint32_t{collision_test(lane(l, i), lane(r, i))} << i;
+	return hits;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// same operations in the same order as the scalar tests and no fma,
+// so every lane agrees with them bit for bit
+__attribute__((target("avx")))
+static __m256 segment_dist2_avx(__m256 cx, __m256 cy, __m256 ox, __m256 oy, __m256 sx, __m256 sy)
+{
+	const auto zero = _mm256_setzero_ps();
+	const auto dx = _mm256_sub_ps(cx, ox);
+	const auto dy = _mm256_sub_ps(cy, oy);
+	const auto ss = _mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy));
+	const auto ds = _mm256_add_ps(_mm256_mul_ps(dx, sx), _mm256_mul_ps(dy, sy));
+	// a point segment has 1/0 masked to 0
+	const auto inv = _mm256_and_ps(_mm256_cmp_ps(ss, zero, _CMP_GT_OQ), _mm256_div_ps(_mm256_set1_ps(1.0f), ss));
+	const auto t = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(ds, inv), zero), _mm256_set1_ps(1.0f));
+	const auto ex = _mm256_sub_ps(dx, _mm256_mul_ps(sx, t));
+	const auto ey = _mm256_sub_ps(dy, _mm256_mul_ps(sy, t));
+	return _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey));
+}
+
+__attribute__((target("avx")))
+static std::uint32_t circle_circle_avx(circle_block const &l, circle_block const &r, std::uint32_t n)
+{
+	const auto dx = _mm256_sub_ps(_mm256_loadu_ps(l.x), _mm256_loadu_ps(r.x));
+	const auto dy = _mm256_sub_ps(_mm256_loadu_ps(l.y), _mm256_loadu_ps(r.y));
+	const auto reach = _mm256_add_ps(_mm256_loadu_ps(l.r), _mm256_loadu_ps(r.r));
+	const auto d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+	const auto hits = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(reach, reach), _CMP_LE_OQ));
+	_mm256_zeroupper();
+	return hits & ((1u << n) - 1);
+}
+
+__attribute__((target("avx")))
+static std::uint32_t circle_ray_avx(circle_block const &l, ray_block const &r, std::uint32_t n)
+{
+	const auto rr = _mm256_mul_ps(_mm256_loadu_ps(l.r), _mm256_loadu_ps(l.r));
+	const auto d2 = segment_dist2_avx(_mm256_loadu_ps(l.x), _mm256_loadu_ps(l.y),
+			_mm256_loadu_ps(r.ox), _mm256_loadu_ps(r.oy), _mm256_loadu_ps(r.sx), _mm256_loadu_ps(r.sy));
+	const auto hits = _mm256_movemask_ps(_mm256_cmp_ps(d2, rr, _CMP_LE_OQ));
+	_mm256_zeroupper();
+	return hits & ((1u << n) - 1);
+}
+
+__attribute__((target("avx")))
+static std::uint32_t circle_triangle_avx(circle_block const &l, triangle_block const &r, std::uint32_t n)
+{
+	const auto zero = _mm256_setzero_ps();
+	const auto cx = _mm256_loadu_ps(l.x), cy = _mm256_loadu_ps(l.y);
+	const auto rr = _mm256_mul_ps(_mm256_loadu_ps(l.r), _mm256_loadu_ps(l.r));
+	const auto ox = _mm256_loadu_ps(r.ox), oy = _mm256_loadu_ps(r.oy);
+	const auto ux = _mm256_loadu_ps(r.ux), uy = _mm256_loadu_ps(r.uy);
+	const auto vx = _mm256_loadu_ps(r.vx), vy = _mm256_loadu_ps(r.vy);
+	const auto rx = _mm256_sub_ps(cx, ox), ry = _mm256_sub_ps(cy, oy);
+	const auto wx = _mm256_sub_ps(vx, ux), wy = _mm256_sub_ps(vy, uy);
+	const auto ax = _mm256_add_ps(ox, ux), ay = _mm256_add_ps(oy, uy);
+	const auto side1 = _mm256_add_ps(_mm256_mul_ps(ux, rx), _mm256_mul_ps(uy, ry));
+	const auto side2 = _mm256_add_ps(_mm256_mul_ps(vx, rx), _mm256_mul_ps(vy, ry));
+	const auto side3 = _mm256_add_ps(_mm256_mul_ps(wx, _mm256_sub_ps(cx, ax)), _mm256_mul_ps(wy, _mm256_sub_ps(cy, ay)));
+	const auto inside = _mm256_and_ps(_mm256_cmp_ps(side1, zero, _CMP_GT_OQ),
+			_mm256_and_ps(_mm256_cmp_ps(side2, zero, _CMP_LT_OQ), _mm256_cmp_ps(side3, zero, _CMP_GT_OQ)));
+	const auto edge1 = _mm256_cmp_ps(segment_dist2_avx(cx, cy, ox, oy, ux, uy), rr, _CMP_LE_OQ);
+	const auto edge2 = _mm256_cmp_ps(segment_dist2_avx(cx, cy, ox, oy, vx, vy), rr, _CMP_LE_OQ);
+	const auto edge3 = _mm256_cmp_ps(segment_dist2_avx(cx, cy, ax, ay, wx, wy), rr, _CMP_LE_OQ);
+	const auto hits = _mm256_movemask_ps(_mm256_or_ps(inside, _mm256_or_ps(edge1, _mm256_or_ps(edge2, edge3))));
+	_mm256_zeroupper();
+	return hits & ((1u << n) - 1);
+}
+
+// sse2 is always there on x86-64, two halves of 4 lanes
+static __m128 segment_dist2_sse2(__m128 cx, __m128 cy, __m128 ox, __m128 oy, __m128 sx, __m128 sy)
+{
+	const auto zero = _mm_setzero_ps();
+	const auto dx = _mm_sub_ps(cx, ox);
+	const auto dy = _mm_sub_ps(cy, oy);
+	const auto ss = _mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy));
+	const auto ds = _mm_add_ps(_mm_mul_ps(dx, sx), _mm_mul_ps(dy, sy));
+	const auto inv = _mm_and_ps(_mm_cmpgt_ps(ss, zero), _mm_div_ps(_mm_set1_ps(1.0f), ss));
+	const auto t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(ds, inv), zero), _mm_set1_ps(1.0f));
+	const auto ex = _mm_sub_ps(dx, _mm_mul_ps(sx, t));
+	const auto ey = _mm_sub_ps(dy, _mm_mul_ps(sy, t));
+	return _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+}
+
+static std::uint32_t circle_circle_sse2(circle_block const &l, circle_block const &r, std::uint32_t n)
+{
+	std::uint32_t hits = 0;
+	for (std::uint32_t at = 0; at < n; at += 4) {
+		const auto dx = _mm_sub_ps(_mm_loadu_ps(l.x + at), _mm_loadu_ps(r.x + at));
+		const auto dy = _mm_sub_ps(_mm_loadu_ps(l.y + at), _mm_loadu_ps(r.y + at));
+		const auto reach = _mm_add_ps(_mm_loadu_ps(l.r + at), _mm_loadu_ps(r.r + at));
+		const auto d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		hits |= _mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(reach, reach))) << at;
+	}
+	return hits & ((1u << n) - 1);
+}
+
+static std::uint32_t circle_ray_sse2(circle_block const &l, ray_block const &r, std::uint32_t n)
+{
+	std::uint32_t hits = 0;
+	for (std::uint32_t at = 0; at < n; at += 4) {
+		const auto rr = _mm_mul_ps(_mm_loadu_ps(l.r + at), _mm_loadu_ps(l.r + at));
+		const auto d2 = segment_dist2_sse2(_mm_loadu_ps(l.x + at), _mm_loadu_ps(l.y + at),
+				_mm_loadu_ps(r.ox + at), _mm_loadu_ps(r.oy + at), _mm_loadu_ps(r.sx + at), _mm_loadu_ps(r.sy + at));
+		hits |= _mm_movemask_ps(_mm_cmple_ps(d2, rr)) << at;
+	}
+	return hits & ((1u << n) - 1);
+}
+
+static std::uint32_t circle_triangle_sse2(circle_block const &l, triangle_block const &r, std::uint32_t n)
+{
+	const auto zero = _mm_setzero_ps();
+	std::uint32_t hits = 0;
+	for (std::uint32_t at = 0; at < n; at += 4) {
+		const auto cx = _mm_loadu_ps(l.x + at), cy = _mm_loadu_ps(l.y + at);
+		const auto rr = _mm_mul_ps(_mm_loadu_ps(l.r + at), _mm_loadu_ps(l.r + at));
+		const auto ox = _mm_loadu_ps(r.ox + at), oy = _mm_loadu_ps(r.oy + at);
+		const auto ux = _mm_loadu_ps(r.ux + at), uy = _mm_loadu_ps(r.uy + at);
+		const auto vx = _mm_loadu_ps(r.vx + at), vy = _mm_loadu_ps(r.vy + at);
+		const auto rx = _mm_sub_ps(cx, ox), ry = _mm_sub_ps(cy, oy);
+		const auto wx = _mm_sub_ps(vx, ux), wy = _mm_sub_ps(vy, uy);
+		const auto ax = _mm_add_ps(ox, ux), ay = _mm_add_ps(oy, uy);
+		const auto side1 = _mm_add_ps(_mm_mul_ps(ux, rx), _mm_mul_ps(uy, ry));
+		const auto side2 = _mm_add_ps(_mm_mul_ps(vx, rx), _mm_mul_ps(vy, ry));
+		const auto side3 = _mm_add_ps(_mm_mul_ps(wx, _mm_sub_ps(cx, ax)), _mm_mul_ps(wy, _mm_sub_ps(cy, ay)));
+		const auto inside = _mm_and_ps(_mm_cmpgt_ps(side1, zero),
+				_mm_and_ps(_mm_cmplt_ps(side2, zero), _mm_cmpgt_ps(side3, zero)));
+		const auto edge1 = _mm_cmple_ps(segment_dist2_sse2(cx, cy, ox, oy, ux, uy), rr);
+		const auto edge2 = _mm_cmple_ps(segment_dist2_sse2(cx, cy, ox, oy, vx, vy), rr);
+		const auto edge3 = _mm_cmple_ps(segment_dist2_sse2(cx, cy, ax, ay, wx, wy), rr);
+		hits |= _mm_movemask_ps(_mm_or_ps(inside, _mm_or_ps(edge1, _mm_or_ps(edge2, edge3)))) << at;
+	}
+	return hits & ((1u << n) - 1);
+}
+#endif
+
+static circle_circle_fn g_circle_circle = test_scalar<circle_block, circle_block>;
+static circle_ray_fn g_circle_ray = test_scalar<circle_block, ray_block>;
+static circle_triangle_fn g_circle_triangle = test_scalar<circle_block, triangle_block>;
+
+simd select_block_kernels(simd widest)
+{
+	g_circle_circle = test_scalar<circle_block, circle_block>;
+	g_circle_ray = test_scalar<circle_block, ray_block>;
+	g_circle_triangle = test_scalar<circle_block, triangle_block>;
+	const auto env = std::getenv("PHOBOS_SIMD");
+	if (env && std::atoi(env) == 0)
+		return simd::scalar;
+#if defined(__x86_64__) || defined(__i386__)
+	if (widest >= simd::avx && __builtin_cpu_supports("avx")) {
+		g_circle_circle = circle_circle_avx;
+		g_circle_ray = circle_ray_avx;
+		g_circle_triangle = circle_triangle_avx;
+		return simd::avx;
+	}
+	if (widest >= simd::sse2 && __builtin_cpu_supports("sse2")) {
+		g_circle_circle = circle_circle_sse2;
+		g_circle_ray = circle_ray_sse2;
+		g_circle_triangle = circle_triangle_sse2;
+		return simd::sse2;
+	}
+#endif
+	return simd::scalar;
+}
+
+// bench/narrow checks the kernels against the scalar tests
+std::uint32_t test_block(circle_block const &l, circle_block const &r, std::uint32_t n)
+{
+	assert(n <= block_lanes);
+	return g_circle_circle(l, r, n);
+}
+
+std::uint32_t test_block(circle_block const &l, ray_block const &r, std::uint32_t n)
+{
+	assert(n <= block_lanes);
+	return g_circle_ray(l, r, n);
+}
+
+std::uint32_t test_block(circle_block const &l, triangle_block const &r, std::uint32_t n)
+{
+	assert(n <= block_lanes);
+	return g_circle_triangle(l, r, n);
+}
+
+} // phobos
@@ -1,61 +1,100 @@
 #include "system.hpp"
+#include "archetype.hpp"
 #include <glm/gtx/norm.hpp>
+#include <bit>
+#include <cmath>
 
 namespace phobos {
 
+// squared distance from c to the segment [o, o+s], written out
+// so the block kernels can repeat it operation for operation
+static float segment_dist2(glm::vec2 c, glm::vec2 o, glm::vec2 s)
+{
+	const auto dx = c.x - o.x, dy = c.y - o.y;
+	const auto ss = s.x * s.x + s.y * s.y;
+	const auto ds = dx * s.x + dy * s.y;
+	const auto inv = ss > 0.0f? 1.0f / ss: 0.0f;
+	const auto t = std::min(std::max(ds * inv, 0.0f), 1.0f);
+	const auto ex = dx - s.x * t, ey = dy - s.y * t;
+	return ex * ex + ey * ey;
+}
+
 bool collision_test(circle const &c, ray const &r)
 {
-	const auto diff = r.origin - c.origin;
-	const auto swept2 = glm::length2(r.swept);
-	const auto diff2 = glm::length2(diff);
-	const auto dot = glm::dot(diff, r.swept);
-	const auto delta_over_4 = dot * dot - swept2 * (diff2 - c.radius * c.radius);
-	if (delta_over_4 < 0) {
-		return false;
-	}
-	const auto root = std::sqrt(delta_over_4);
-	const auto time_lo = (-dot - root) / swept2;
-	const auto time_hi = (-dot + root) / swept2;
-	if (time_hi < 0.0f) {
-		return false;
-	} else if (time_lo > 1.0f) {
-		return false;
-	}
-	if (time_hi <= 1.0f) {
-		// time_hi
-		return true;
-	} else {
-		// time_lo
-		return true;
-	}
+	return segment_dist2(c.origin, r.origin, r.swept) <= c.radius * c.radius;
 }
 
 bool collision_test(circle const &c, triangle const &t)
 {
-	const auto rebased = c.origin - t.origin;
-	// triangle in circle
-	if (glm::length2(rebased) <= c.radius * c.radius)
-		return true;
-	const auto side1 = glm::dot(t.u, rebased);
-	const auto side2 = glm::dot(t.v, rebased);
-	const auto side3 = glm::dot(t.v-t.u, c.origin - (t.origin+t.u));
+	const auto rx = c.origin.x - t.origin.x, ry = c.origin.y - t.origin.y;
+	const auto w = t.v - t.u;
+	const auto a = t.origin + t.u;
+	const auto side1 = t.u.x * rx + t.u.y * ry;
+	const auto side2 = t.v.x * rx + t.v.y * ry;
+	const auto side3 = w.x * (c.origin.x - a.x) + w.y * (c.origin.y - a.y);
 	// circle in triangle
 	if (side1 > 0.0f && side2 < 0.0f && side3 > 0.0f)
 		return true;
-	// triangle edge on circle boundary
-	if (collision_test(c, ray{ t.origin, t.u }))
-		return true;
-	if (collision_test(c, ray{ t.origin, t.v }))
-		return true;
-	if (collision_test(c, ray{ t.origin+t.u, t.v-t.u }))
-		return true;
-	return false;
+	// triangle edge in circle, corners included
+	const auto rr = c.radius * c.radius;
+	return segment_dist2(c.origin, t.origin, t.u) <= rr
+	    || segment_dist2(c.origin, t.origin, t.v) <= rr
+	    || segment_dist2(c.origin, a, w) <= rr;
 }
 
 bool collision_test(circle const &c1, circle const &c2)
 {
-	const auto diff = c1.origin - c2.origin;
-	return glm::length2(diff) <= c1.radius + c2.radius;
+	const auto dx = c1.origin.x - c2.origin.x, dy = c1.origin.y - c2.origin.y;
+	const auto reach = c1.radius + c2.radius;
+	return dx * dx + dy * dy <= reach * reach;
+}
+
+// fraction of m before p moving by m enters the disk, above 1 if it
+// never does, p is outside
+static float enter_disk(glm::vec2 p, glm::vec2 m, glm::vec2 center, float r)
+{
+	const auto d = p - center;
+	const auto a = glm::dot(m, m);
+	const auto b = glm::dot(d, m);
+	const auto c = glm::dot(d, d) - r * r;
+	const auto disc = b * b - a * c;
+	// moving away or past it
+	if (b >= 0.0f || a <= 0.0f || disc < 0.0f)
+		return 2.0f;
+	return c / (-b + std::sqrt(disc));
+}
+
+float time_of_impact(circle const &c1, glm::vec2 m1, circle const &c2, glm::vec2 m2)
+{
+	if (collision_test(c1, c2))
+		return 0.0f;
+	// c1 against c2 standing still, grown by c1's radius
+	return enter_disk(c1.origin, m1 - m2, c2.origin, c1.radius + c2.radius);
+}
+
+float time_of_impact(circle const &c, glm::vec2 m, ray const &r)
+{
+	if (collision_test(c, r))
+		return 0.0f;
+	// the center against the segment grown by the radius: disks
+	// at the ends and a side on either way
+	auto t = std::min(
+		enter_disk(c.origin, m, r.origin, c.radius),
+		enter_disk(c.origin, m, r.origin + r.swept, c.radius));
+	const auto ss = glm::dot(r.swept, r.swept);
+	if (ss <= 0.0f)
+		return t;
+	const auto n = glm::vec2{ -r.swept.y, r.swept.x } / std::sqrt(ss);
+	const auto dist = glm::dot(c.origin - r.origin, n);
+	const auto dn = glm::dot(m, n);
+	// beside the segment already, only its ends are in the way
+	if (std::abs(dist) <= c.radius || dist * dn >= 0.0f)
+		return t;
+	const auto side = (std::copysign(c.radius, dist) - dist) / dn;
+	const auto at = glm::dot(c.origin + side * m - r.origin, r.swept);
+	if (at >= 0.0f && at <= ss)
+		t = std::min(t, side);
+	return t;
 }
 
 bool collision_test(ray const &r1, ray const &r2)
@@ -96,47 +135,137 @@ bool collision_test(auto const &c, wall_mesh const &m)
 	return false;
 }
 
+// a plain circle, colliders take the template
+bool collision_test(circle const &c, wall_mesh const &m)
+{
+	return collision_test<circle>(c, m);
+}
+
 bool collision_test(triangle const &t, ray const &r)
 {
 	// assumes t is thin
 	return collision_test(ray{t.origin, t.u}, r);
 }
 
-void phys::collider_circle(entity e)
+static aabb bounds(circle const &c)
+{
+	const glm::vec2 r{ c.radius, c.radius };
+	return { c.origin - r, c.origin + r };
+}
+
+static aabb bounds(triangle const &t)
+{
+	const auto u = t.origin + t.u, v = t.origin + t.v;
+	return { glm::min(t.origin, glm::min(u, v)), glm::max(t.origin, glm::max(u, v)) };
+}
+
+static aabb bounds(ray const &r)
+{
+	const auto to = r.origin + r.swept;
+	return { glm::min(r.origin, to), glm::max(r.origin, to) };
+}
+
+static aabb bounds(wall_mesh const &m)
+{
+	aabb box{ m[0], m[0] };
+	for (const auto &p : m) {
+		box.min = glm::min(box.min, p);
+		box.max = glm::max(box.max, p);
+	}
+	return box;
+}
+
+static float cast(ray const &r, circle const &c)
+{
+	const auto diff = r.origin - c.origin;
+	const auto swept2 = glm::length2(r.swept);
+	const auto dot = glm::dot(diff, r.swept);
+	const auto delta_over_4 = dot * dot - swept2 * (glm::length2(diff) - c.radius * c.radius);
+	if (delta_over_4 < 0)
+		return std::numeric_limits<float>::infinity();
+	const auto root = std::sqrt(delta_over_4);
+	const auto time_lo = (-dot - root) / swept2;
+	const auto time_hi = (-dot + root) / swept2;
+	if (time_hi < 0.0f)
+		return std::numeric_limits<float>::infinity();
+	// starting inside counts as a hit right away
+	return std::max(time_lo, 0.0f);
+}
+
+static float cast(ray const &r, ray const &edge)
+{
+	static constexpr float epsilon = 1e-6;
+	const auto det = r.swept.x * edge.swept.y - r.swept.y * edge.swept.x;
+	if (glm::abs(det) < epsilon)
+		return std::numeric_limits<float>::infinity();
+	const auto diff = edge.origin - r.origin;
+	const auto t = (diff.x * edge.swept.y - diff.y * edge.swept.x) / det;
+	const auto s = (diff.x * r.swept.y - diff.y * r.swept.x) / det;
+	if (t < 0.0f || s < 0.0f || s > 1.0f)
+		return std::numeric_limits<float>::infinity();
+	return t;
+}
+
+static float cast(ray const &r, triangle const &t)
+{
+	return std::min({
+		cast(r, ray{ t.origin, t.u }),
+		cast(r, ray{ t.origin, t.v }),
+		cast(r, ray{ t.origin+t.u, t.v-t.u }),
+	});
+}
+
+void phys::collider_circle(entity e, std::uint32_t layer, std::uint32_t mask)
 {
 	// dynamically updated
 	const std::uint32_t type_idx = collider<circle>::bit;
-	circle_.emplace_back(collider<circle>{ circle{}, e });
+	circle_.emplace_back(collider<circle>{ circle{}, e, layer, mask });
 	const std::uint32_t idx = type_idx | circle_.size()-1 << type_shift;
 	add_component(e, system_id::phys);
 	reindex(e, system_id::phys, idx);
+	// placed by the next update()
+	track(e, aabb{});
 }
 
-void phys::collider_triangle(entity e)
+void phys::collider_triangle(entity e, std::uint32_t layer, std::uint32_t mask)
 {
 	const std::uint32_t type_idx = collider<triangle>::bit;
-	triangle_.emplace_back(collider<triangle>{ triangle{}, e });
+	triangle_.emplace_back(collider<triangle>{ triangle{}, e, layer, mask });
 	const std::uint32_t idx = type_idx | triangle_.size()-1 << type_shift;
 	add_component(e, system_id::phys);
 	reindex(e, system_id::phys, idx);
+	// placed by the next update()
+	track(e, aabb{});
 }
 
-void phys::collider_ray(entity e)
+void phys::collider_ray(entity e, std::uint32_t layer, std::uint32_t mask)
 {
 	const std::uint32_t type_idx = collider<ray>::bit;
-	ray_.emplace_back(collider<ray>{ ray{}, e });
+	ray_.emplace_back(collider<ray>{ ray{}, e, layer, mask });
 	const std::uint32_t idx = type_idx | ray_.size()-1 << type_shift;
 	add_component(e, system_id::phys);
 	reindex(e, system_id::phys, idx);
+	// placed by the next update()
+	track(e, aabb{});
 }
 
-void phys::collider_wall_mesh(entity e, wall_mesh const &m)
+void phys::collider_wall_mesh(entity e, wall_mesh const &m, std::uint32_t layer, std::uint32_t mask)
 {
 	const std::uint32_t type_idx = collider<wall_mesh>::bit;
-	wall_mesh_.emplace_back(collider<wall_mesh>{ m, e });
+	wall_mesh_.emplace_back(collider<wall_mesh>{ m, e, layer, mask });
+	wall_bvh_.emplace_back().build(m);
+	auto &sdf = wall_sdf_.emplace_back();
+	if (sdf_cell > 0.0f) {
+		const auto cache = std::getenv("PHOBOS_SDF_CACHE");
+		sdf.bake(wall_bvh_.back(), m, sdf_cell, 1.0f, cache? cache: "");
+	}
 	const std::uint32_t idx = type_idx | wall_mesh_.size()-1 << type_shift;
 	add_component(e, system_id::phys);
 	reindex(e, system_id::phys, idx);
+	assert(!m.empty());
+	track(e, bounds(m));
+	wall_mesh_.back().fixed = true;
+	static_leaves_.insert(entity_index(e), static_tree_.insert(bounds(m), e));
 }
 
 void phys::remove(entity e)
@@ -167,16 +296,138 @@ void phys::remove(entity e)
 	case collider<wall_mesh>::bit:
 		swapped_idx = wall_mesh_.size()-1;
 		wall_mesh_[removed_idx] = wall_mesh_[swapped_idx];
+		wall_bvh_[removed_idx] = std::move(wall_bvh_[swapped_idx]);
+		wall_sdf_[removed_idx] = std::move(wall_sdf_[swapped_idx]);
 		reindex(wall_mesh_[removed_idx].id, system_id::phys, idx);
 		wall_mesh_.pop_back();
+		wall_bvh_.pop_back();
+		wall_sdf_.pop_back();
 		break;
 	}
 	del_component(e, system_id::phys);
+	sweep_.remove(e);
+	tree_.remove(leaves_.at(entity_index(e)));
+	leaves_.erase(entity_index(e));
+	if (static_leaves_.contains(entity_index(e))) {
+		static_tree_.remove(static_leaves_.at(entity_index(e)));
+		static_leaves_.erase(entity_index(e));
+	}
+	if (sleeping_leaves_.contains(entity_index(e))) {
+		sleeping_tree_.remove(sleeping_leaves_.at(entity_index(e)));
+		sleeping_leaves_.erase(entity_index(e));
+	}
+	std::erase(stale_, e);
+}
+
+void phys::make_static(entity e)
+{
+	const auto idx = index(e, system_id::phys);
+	// walls are static from the start
+	if ((idx & type_mask) == collider<wall_mesh>::bit)
+		return;
+	wake(e);
+	visit(idx, [] (auto &c) { c.fixed = true; });
+	sweep_.remove(e);
+	invalidate(e);
+}
 
+void phys::invalidate(entity e)
+{
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	switch (idx & type_mask) {
+	case collider<circle>::bit: circle_[at].stale = true; break;
+	case collider<triangle>::bit: triangle_[at].stale = true; break;
+	case collider<ray>::bit: ray_[at].stale = true; break;
+	// the edge structures are baked from the mesh, not the transform
+	case collider<wall_mesh>::bit: return;
+	}
+	if (std::find(std::begin(stale_), std::end(stale_), e) == std::end(stale_))
+		stale_.push_back(e);
+}
+
+void phys::place_static(entity e)
+{
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	aabb box;
+	switch (idx & type_mask) {
+	case collider<circle>::bit:
+		box = bounds(circle_[at]);
+		circle_[at].stale = false;
+		// placing it is no motion to sweep
+		circle_[at].last = circle_[at].origin;
+		break;
+	case collider<triangle>::bit: box = bounds(triangle_[at]); triangle_[at].stale = false; break;
+	case collider<ray>::bit: box = bounds(ray_[at]); ray_[at].stale = false; break;
+	default: return;
+	}
+	const auto i = entity_index(e);
+	// sleepers only meet awake colliders, so the ones around where e
+	// was and where it goes are woken to test their pairs with it again
+	sleeping_tree_.query(merge(tree_.box(leaves_.at(i)), box), [this] (entity s) { waking_.push_back(s); });
+	for (const auto s : waking_)
+		wake(s);
+	waking_.clear();
+	tree_.move(leaves_.at(i), box);
+	if (static_leaves_.contains(i)) {
+		static_tree_.remove(static_leaves_.at(i));
+		static_leaves_.at(i) = static_tree_.insert(box, e);
+	} else {
+		static_leaves_.insert(i, static_tree_.insert(box, e));
+	}
+}
+
+void phys::track(entity e, aabb const &box)
+{
+	leaves_.insert(entity_index(e), tree_.insert(box, e));
+}
+
+// name's value when it is a finite number above 0, or 0 when
+// that turns the feature off, otherwise value keeps its default
+static void parse_env(const char *name, float &value, bool zero_off = false)
+{
+	const auto env = std::getenv(name);
+	if (!env)
+		return;
+	char *end;
+	const auto v = std::strtof(env, &end);
+	if (end != env && !*end && std::isfinite(v) && (v > 0.0f || (zero_off && v == 0.0f)))
+		value = v;
+	else
+		std::print("[PHYS] Ignoring {}={}, expected a {} number\n", name, env, zero_off? "non-negative": "positive");
 }
 
 int phys::init()
 {
+	if (const auto env = std::getenv("PHOBOS_BROADPHASE")) {
+		const std::string_view name = env;
+		if (name == "brute")
+			mode = broadphase::brute;
+		else if (name == "grid")
+			mode = broadphase::grid;
+		else if (name == "sweep")
+			mode = broadphase::sweep;
+		else
+			std::print("[PHYS] Unknown broadphase {}, using the default\n", name);
+	}
+	parse_env("PHOBOS_CELL", cell_size);
+	parse_env("PHOBOS_SDF", sdf_cell, true);
+	assert(cell_size > 0.0f);
+	grid_.cell_size = cell_size;
+	static_tree_.margin = 0.0f;
+	sleeping_tree_.margin = 0.0f;
+	if (const auto env = std::getenv("PHOBOS_SLEEP")) {
+		// signed, so -1 doesn't wrap into never sleeping
+		char *end;
+		const auto n = std::strtol(env, &end, 10);
+		if (end != env && !*end && n >= 0 && n <= std::numeric_limits<std::uint32_t>::max())
+			sleep_ticks = n;
+		else
+			std::print("[PHYS] Ignoring PHOBOS_SLEEP={}, expected a tick count\n", env);
+	}
+	parse_env("PHOBOS_CCD", ccd_fraction, true);
+	select_block_kernels();
 	return 0;
 }
 
@@ -186,22 +437,40 @@ void phys::fini()
 
 void phys::update_colliders()
 {
-	for (auto &col : circle_) {
-		auto tfm = system.tfms.world(col.id);
-		col.origin = tfm.pos();
-		col.radius = tfm.x().x * 0.5f;
-	}
-	for (auto &col : triangle_) {
-		auto tfm = system.tfms.world(col.id);
-		col.origin = tfm.pos();
-		col.u = tfm.x();
-		col.v = tfm.y();
-	}
-	for (auto &col : ray_) {
-		auto tfm = system.tfms.world(col.id);
-		col.origin = tfm.pos();
-		col.swept = tfm.x();
-	}
+	static view<system_id::tfms, system_id::phys> colliders;
+	colliders.par_each([this] (entity, std::uint32_t tfm_idx, std::uint32_t col_idx)
+	{
+		const std::uint32_t idx = col_idx >> type_shift;
+		const auto placed = [] (auto const &c) { return c.fixed && !c.stale; };
+		switch (col_idx & type_mask) {
+		case collider<circle>::bit:
+			if (!placed(circle_[idx])) {
+				auto &c = circle_[idx];
+				const auto tfm = system.tfms.world_at(tfm_idx);
+				// nothing to sweep from on the first one
+				c.last = c.placed? c.origin: tfm.pos();
+				c.placed = true;
+				c.origin = tfm.pos();
+				c.radius = tfm.x().x * 0.5f;
+			}
+			break;
+		case collider<triangle>::bit:
+			if (!placed(triangle_[idx])) {
+				const auto tfm = system.tfms.world_at(tfm_idx);
+				triangle_[idx].origin = tfm.pos();
+				triangle_[idx].u = tfm.x();
+				triangle_[idx].v = tfm.y();
+			}
+			break;
+		case collider<ray>::bit:
+			if (!placed(ray_[idx])) {
+				const auto tfm = system.tfms.world_at(tfm_idx);
+				ray_[idx].origin = tfm.pos();
+				ray_[idx].swept = tfm.x();
+			}
+			break;
+		}
+	});
 }
 
 static void collision(auto *map, entity e, entity other)
@@ -211,34 +480,547 @@ static void collision(auto *map, entity e, entity other)
 	map->emplace_back(other, e);
 }
 
+entity phys::entity_of(std::uint32_t ref) const
+{
+	const auto idx = ref >> type_shift;
+	switch (ref & type_mask) {
+	case collider<circle>::bit: return circle_[idx].id;
+	case collider<triangle>::bit: return triangle_[idx].id;
+	case collider<ray>::bit: return ray_[idx].id;
+	case collider<wall_mesh>::bit: return wall_mesh_[idx].id;
+	}
+	return 0;
+}
+
+std::pair<std::uint32_t, std::uint32_t> phys::layers_of(std::uint32_t ref) const
+{
+	const auto idx = ref >> type_shift;
+	switch (ref & type_mask) {
+	case collider<circle>::bit: return { circle_[idx].layer, circle_[idx].mask };
+	case collider<triangle>::bit: return { triangle_[idx].layer, triangle_[idx].mask };
+	case collider<ray>::bit: return { ray_[idx].layer, ray_[idx].mask };
+	case collider<wall_mesh>::bit: return { wall_mesh_[idx].layer, wall_mesh_[idx].mask };
+	}
+	return { 0, 0 };
+}
+
+bool phys::filtered(std::uint32_t l, std::uint32_t r) const
+{
+	const auto [llayer, lmask] = layers_of(l);
+	const auto [rlayer, rmask] = layers_of(r);
+	return !(llayer & rmask) || !(rlayer & lmask);
+}
+
+static std::uint64_t pair_key(entity a, entity b)
+{
+	if (a > b)
+		std::swap(a, b);
+	return std::uint64_t{a} << 32 | b;
+}
+
+void phys::subscribe(entity e, entity with)
+{
+	if (!with) {
+		const auto idx = entity_index(e);
+		if (watched_.contains(idx))
+			++watched_.at(idx);
+		else
+			watched_.insert(idx, 1);
+		return;
+	}
+	++watched_pairs_[pair_key(e, with)];
+}
+
+void phys::unsubscribe(entity e, entity with)
+{
+	if (!with) {
+		const auto idx = entity_index(e);
+		if (--watched_.at(idx) == 0)
+			watched_.erase(idx);
+		return;
+	}
+	const auto it = watched_pairs_.find(pair_key(e, with));
+	assert(it != std::end(watched_pairs_));
+	if (--it->second == 0)
+		watched_pairs_.erase(it);
+}
+
+void phys::subscribe_layers(std::uint32_t l, std::uint32_t r)
+{
+	watched_layers_.emplace_back(l, r);
+}
+
+void phys::subscribe_all()
+{
+	++wildcards_;
+}
+
+void phys::unsubscribe_all()
+{
+	assert(wildcards_);
+	--wildcards_;
+}
+
+bool phys::subscribed(std::uint32_t l, std::uint32_t r) const
+{
+	if (wildcards_)
+		return true;
+	const auto le = entity_of(l), re = entity_of(r);
+	// the index alone may name an older entity, that only costs a test
+	if (watched_.contains(entity_index(le)) || watched_.contains(entity_index(re)))
+		return true;
+	if (!watched_layers_.empty()) {
+		const auto ll = layers_of(l).first, rl = layers_of(r).first;
+		for (const auto &[a, b] : watched_layers_)
+			if ((a & ll && b & rl) || (a & rl && b & ll))
+				return true;
+	}
+	return watched_pairs_.contains(pair_key(le, re));
+}
+
+template <typename F>
+void phys::visit(std::uint32_t ref, F &&fn)
+{
+	const auto at = ref >> type_shift;
+	switch (ref & type_mask) {
+	case collider<circle>::bit: fn(circle_[at]); break;
+	case collider<triangle>::bit: fn(triangle_[at]); break;
+	case collider<ray>::bit: fn(ray_[at]); break;
+	}
+}
+
+void phys::sleep(entity e, aabb const &box)
+{
+	visit(index(e, system_id::phys), [] (auto &c) { c.asleep = true; });
+	sleeping_leaves_.insert(entity_index(e), sleeping_tree_.insert(box, e));
+	sweep_.remove(e);
+}
+
+void phys::wake(entity e)
+{
+	const auto i = entity_index(e);
+	if (!sleeping_leaves_.contains(i))
+		return;
+	visit(index(e, system_id::phys), [] (auto &c)
+	{
+		c.asleep = false;
+		c.still = 0;
+	});
+	sleeping_tree_.remove(sleeping_leaves_.at(i));
+	sleeping_leaves_.erase(i);
+}
+
+bool phys::resting(entity e) const
+{
+	if (!has_component(e, system_id::phys))
+		return false;
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	switch (idx & type_mask) {
+	case collider<circle>::bit: return circle_[at].fixed || circle_[at].asleep;
+	case collider<triangle>::bit: return triangle_[at].fixed || triangle_[at].asleep;
+	case collider<ray>::bit: return ray_[at].fixed || ray_[at].asleep;
+	}
+	return true;
+}
+
+// wakes sleepers that moved, puts the ones that stayed still long
+// enough to sleep and carries the pairs of resting colliders over
+void phys::settle()
+{
+	const auto moved = [this] (aabb const &a, aabb const &b)
+	{
+		const auto d = glm::max(glm::abs(a.min - b.min), glm::abs(a.max - b.max));
+		return std::max(d.x, d.y) > sleep_epsilon;
+	};
+	// every dynamic collider for now, the sleepers are taken out
+	// once update() knows who woke up
+	awake = 0;
+	const auto settle = [&] (auto &colliders)
+	{
+		for (auto &c : colliders) {
+			if (c.fixed)
+				continue;
+			++awake;
+			// sleepers compare against where they fell asleep so
+			// a slow drift still wakes them eventually
+			const auto box = bounds(c);
+			const bool move = moved(box, c.rest);
+			if (c.asleep && !move)
+				continue;
+			c.rest = box;
+			if (c.asleep)
+				wake(c.id);
+			else if (move)
+				c.still = 0;
+			else if (sleep_ticks && ++c.still >= sleep_ticks)
+				sleep(c.id, box);
+		}
+	};
+	settle(circle_);
+	settle(triangle_);
+	settle(ray_);
+
+	// nothing could have changed between two resting colliders,
+	// unless one of them was just placed
+	const auto placed = [this] (entity e)
+	{
+		return std::find(std::begin(stale_), std::end(stale_), e) != std::end(stale_);
+	};
+	for (const auto &[key, frame] : contacts_) {
+		const entity l = key >> 32, r = key & 0xffffffff;
+		if (resting(l) && resting(r) && !placed(l) && !placed(r))
+			collision(&colliding, l, r);
+	}
+}
+
+void phys::publish()
+{
+	began.clear();
+	persisting.clear();
+	ended.clear();
+	++frame_;
+	// colliding holds both ways round, one is enough here
+	for (const auto &[main, other] : colliding) {
+		if (main > other)
+			continue;
+		const auto [it, ins] = contacts_.try_emplace(pair_key(main, other), frame_);
+		if (ins) {
+			collision(&began, main, other);
+		} else if (it->second != frame_) {
+			it->second = frame_;
+			collision(&persisting, main, other);
+		}
+	}
+	std::erase_if(contacts_, [this] (auto const &contact)
+	{
+		const auto [key, frame] = contact;
+		if (frame == frame_)
+			return false;
+		collision(&ended, key >> 32, key & 0xffffffff);
+		return true;
+	});
+	colliding_by.build(colliding);
+	began_by.build(began);
+}
+
+void phys::contact_index::build(std::vector<collision_data> &pairs)
+{
+	// only the rows of the last build need resetting
+	for (const auto e : entities_)
+		rows_[entity_index(e)].e = 0;
+	entities_.clear();
+	std::sort(std::begin(pairs), std::end(pairs), [] (auto const &l, auto const &r)
+	{
+		return l.main != r.main? l.main < r.main: l.other < r.other;
+	});
+	pairs_ = pairs;
+	for (std::uint32_t at = 0; at < pairs.size();) {
+		const auto e = pairs[at].main;
+		auto end = at+1;
+		while (end < pairs.size() && pairs[end].main == e)
+			++end;
+		rows_.ensure(entity_index(e));
+		rows_[entity_index(e)] = rows{ e, at, end - at };
+		entities_.push_back(e);
+		at = end;
+	}
+}
+
+template <typename T>
+bool phys::hits_wall(T const &shape, std::uint32_t w) const
+{
+	if constexpr (std::is_base_of_v<circle, T>) {
+		// only circles close to the surface need the edges
+		const auto &sdf = wall_sdf_[w];
+		if (!sdf.empty() && sdf.covers(shape.origin)) {
+			const auto d = std::abs(sdf.distance(shape.origin));
+			if (d > shape.radius + sdf.slack())
+				return false;
+			if (d < shape.radius - sdf.slack())
+				return true;
+		}
+	}
+	return wall_bvh_[w].query(bounds(shape), [&] (glm::vec2 from, glm::vec2 swept)
+	{
+		return collision_test(shape, ray{ from, swept });
+	});
+}
+
+bool phys::fast(collider<circle> const &c) const
+{
+	const auto m = c.origin - c.last;
+	const auto reach = ccd_fraction * c.radius;
+	return !c.fixed && ccd_fraction > 0.0f && glm::dot(m, m) > reach * reach;
+}
+
+float phys::sweep_wall(collider<circle> const &c, std::uint32_t w) const
+{
+	const circle from{ c.last, c.radius };
+	const auto m = c.origin - c.last;
+	auto t = 2.0f;
+	wall_bvh_[w].query(merge(bounds(from), bounds(c)), [&] (glm::vec2 o, glm::vec2 swept)
+	{
+		t = std::min(t, time_of_impact(from, m, ray{ o, swept }));
+		return t == 0.0f;
+	});
+	return t;
+}
+
+void phys::narrowphase(std::uint32_t l, std::uint32_t r)
+{
+	// circle < ray < triangle < wall
+	if ((l & type_mask) > (r & type_mask))
+		std::swap(l, r);
+	const auto li = l >> type_shift, ri = r >> type_shift;
+	switch ((l & type_mask) << type_shift | (r & type_mask)) {
+	// circles wait for a block of their kind
+	case collider<circle>::bit << type_shift | collider<circle>::bit:
+		if (fast(circle_[li]) || fast(circle_[ri])) {
+			const auto &a = circle_[li], &b = circle_[ri];
+			const auto t = time_of_impact(circle{ a.last, a.radius }, a.origin - a.last, circle{ b.last, b.radius }, b.origin - b.last);
+			if (t <= 1.0f) {
+				collision(&colliding, a.id, b.id);
+				impacts.emplace_back(a.id, b.id, t);
+			}
+		} else {
+			circle_circle_.emplace_back(li, ri);
+		}
+		break;
+	case collider<circle>::bit << type_shift | collider<ray>::bit:
+		circle_ray_.emplace_back(li, ri);
+		break;
+	case collider<circle>::bit << type_shift | collider<triangle>::bit:
+		circle_triangle_.emplace_back(li, ri);
+		break;
+	case collider<ray>::bit << type_shift | collider<triangle>::bit:
+		if (collision_test(triangle_[ri], ray_[li]))
+			collision(&colliding, triangle_[ri].id, ray_[li].id);
+		break;
+	case collider<circle>::bit << type_shift | collider<wall_mesh>::bit:
+		if (fast(circle_[li])) {
+			const auto t = sweep_wall(circle_[li], ri);
+			if (t <= 1.0f) {
+				collision(&colliding, circle_[li].id, wall_mesh_[ri].id);
+				impacts.emplace_back(circle_[li].id, wall_mesh_[ri].id, t);
+			}
+		} else if (hits_wall(circle_[li], ri)) {
+			collision(&colliding, circle_[li].id, wall_mesh_[ri].id);
+		}
+		break;
+	case collider<triangle>::bit << type_shift | collider<wall_mesh>::bit:
+		if (hits_wall(triangle_[li], ri))
+			collision(&colliding, triangle_[li].id, wall_mesh_[ri].id);
+		break;
+	// rays against rays, walls or triangles against triangles aren't tested
+	default:
+		break;
+	}
+}
+
+static void fill(circle_block &b, std::uint32_t i, circle const &c)
+{
+	b.x[i] = c.origin.x;
+	b.y[i] = c.origin.y;
+	b.r[i] = c.radius;
+}
+
+static void fill(ray_block &b, std::uint32_t i, ray const &r)
+{
+	b.ox[i] = r.origin.x;
+	b.oy[i] = r.origin.y;
+	b.sx[i] = r.swept.x;
+	b.sy[i] = r.swept.y;
+}
+
+static void fill(triangle_block &b, std::uint32_t i, triangle const &t)
+{
+	b.ox[i] = t.origin.x;
+	b.oy[i] = t.origin.y;
+	b.ux[i] = t.u.x;
+	b.uy[i] = t.u.y;
+	b.vx[i] = t.v.x;
+	b.vy[i] = t.v.y;
+}
+
+void phys::narrowphase_blocks()
+{
+	const auto run = [this] <typename B> (auto &pairs, auto const &others, B)
+	{
+		for (size_t at = 0; at < pairs.size(); at += block_lanes) {
+			const std::uint32_t n = std::min<size_t>(block_lanes, pairs.size() - at);
+			// zeroed so the unused lanes hold no garbage
+			circle_block l{};
+			B r{};
+			for (std::uint32_t i = 0; i < n; ++i) {
+				fill(l, i, circle_[pairs[at+i].first]);
+				fill(r, i, others[pairs[at+i].second]);
+			}
+			for (auto hits = test_block(l, r, n); hits; hits &= hits - 1) {
+				const auto [li, ri] = pairs[at + std::countr_zero(hits)];
+				collision(&colliding, circle_[li].id, others[ri].id);
+			}
+		}
+		pairs.clear();
+	};
+	run(circle_circle_, circle_, circle_block{});
+	run(circle_ray_, ray_, ray_block{});
+	run(circle_triangle_, triangle_, triangle_block{});
+}
+
 void phys::update(float, float dt)
 {
 	colliding.clear();
+	impacts.clear();
 	update_colliders();
-#define INNERLOOP(type) do \
-		for (auto &col2 : type##_) { \
-			if (collision_test(col1, col2)) { \
-				collision(&colliding, col1.id, col2.id); \
-			} \
-		} while (0)
-
-	for (size_t i1 = 0; i1 < circle_.size(); ++i1) {
-		auto &col1 = circle_[i1];
-		for (size_t i2 = i1+1; i2 < circle_.size(); ++i2) {
-			auto &col2 = circle_[i2];
-			if (collision_test(col1, col2)) {
-				collision(&colliding, col1.id, col2.id);
-			}
+	for (const auto e : stale_)
+		place_static(e);
+	settle();
+	stale_.clear();
+
+	// only the awake dynamic colliders go through the broadphase
+	bounds_.clear();
+	refs_.clear();
+	const auto bound = [this] (auto const &colliders)
+	{
+		using T = std::remove_cvref_t<decltype(colliders[0])>;
+		for (std::uint32_t i = 0; i < colliders.size(); ++i) {
+			if (colliders[i].fixed || colliders[i].asleep)
+				continue;
+			auto box = bounds(colliders[i]);
+			// fast circles cover all the way from where they were
+			if constexpr (std::is_same_v<T, collider<circle>>)
+				if (fast(colliders[i]))
+					box = merge(box, bounds(circle{ colliders[i].last, colliders[i].radius }));
+			bounds_.push_back(box);
+			refs_.push_back(T::bit | i << type_shift);
+		}
+	};
+	bound(circle_);
+	bound(triangle_);
+	bound(ray_);
+	for (std::uint32_t i = 0; i < bounds_.size(); ++i)
+		tree_.move(leaves_.at(entity_index(entity_of(refs_[i]))), bounds_[i]);
+
+	tested = skipped = 0;
+	const auto narrow = [this] (std::uint32_t l, std::uint32_t r)
+	{
+		if (filtered(l, r) || !subscribed(l, r)) {
+			++skipped;
+			return;
 		}
-		INNERLOOP(triangle);
-		INNERLOOP(ray);
-		INNERLOOP(wall_mesh);
+		++tested;
+		narrowphase(l, r);
+	};
+	switch (mode) {
+	case broadphase::brute:
+		for (std::uint32_t i = 0; i < bounds_.size(); ++i)
+			for (auto j = i+1; j < bounds_.size(); ++j)
+				if (overlap(bounds_[i], bounds_[j]))
+					narrow(refs_[i], refs_[j]);
+		break;
+	case broadphase::grid:
+		grid_.clear();
+		for (std::uint32_t i = 0; i < bounds_.size(); ++i)
+			grid_.insert(bounds_[i], refs_[i]);
+		grid_.build();
+		grid_.pairs(narrow);
+		break;
+	case broadphase::sweep:
+		for (std::uint32_t i = 0; i < bounds_.size(); ++i)
+			sweep_.set(entity_of(refs_[i]), bounds_[i], refs_[i]);
+		sweep_.update();
+		sweep_.pairs(narrow);
+		break;
+	}
+
+	// then each against the static and sleeping ones it overlaps,
+	// which wakes the latter
+	for (std::uint32_t i = 0; i < bounds_.size(); ++i) {
+		static_tree_.query(bounds_[i], [&] (entity e) { narrow(refs_[i], index(e, system_id::phys)); });
+		sleeping_tree_.query(bounds_[i], [&] (entity e)
+		{
+			narrow(refs_[i], index(e, system_id::phys));
+			waking_.push_back(e);
+		});
 	}
-	for (size_t i1 = 0; i1 < triangle_.size(); ++i1) {
-		auto &col1 = triangle_[i1];
-		INNERLOOP(ray);
-		INNERLOOP(wall_mesh);
+	for (const auto e : waking_)
+		wake(e);
+	waking_.clear();
+
+	narrowphase_blocks();
+	std::sort(std::begin(impacts), std::end(impacts), [] (auto const &l, auto const &r) { return l.t < r.t; });
+	publish();
+	sleeping = sleeping_leaves_.size();
+	awake -= sleeping;
+}
+
+std::uint32_t phys::layer_of(entity e) const
+{
+	return layers_of(index(e, system_id::phys)).first;
+}
+
+bool phys::touches(entity e, aabb const &box) const
+{
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	switch (idx & type_mask) {
+	case collider<circle>::bit: return overlap(bounds(circle_[at]), box);
+	case collider<triangle>::bit: return overlap(bounds(triangle_[at]), box);
+	case collider<ray>::bit: return overlap(bounds(ray_[at]), box);
+	case collider<wall_mesh>::bit: return wall_bvh_[at].query(box, [] (glm::vec2, glm::vec2) { return true; });
 	}
+	return false;
+}
+
+bool phys::touches(entity e, circle const &c) const
+{
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	switch (idx & type_mask) {
+	case collider<circle>::bit: return collision_test(c, circle_[at]);
+	case collider<triangle>::bit: return collision_test(c, triangle_[at]);
+	case collider<ray>::bit: return collision_test(c, ray_[at]);
+	case collider<wall_mesh>::bit: return hits_wall(c, at);
+	}
+	return false;
+}
+
+float phys::cast(entity e, ray const &r) const
+{
+	const auto idx = index(e, system_id::phys);
+	const auto at = idx >> type_shift;
+	switch (idx & type_mask) {
+	case collider<circle>::bit: return phobos::cast(r, circle_[at]);
+	case collider<triangle>::bit: return phobos::cast(r, triangle_[at]);
+	case collider<ray>::bit: return phobos::cast(r, ray_[at]);
+	case collider<wall_mesh>::bit: {
+		auto first = std::numeric_limits<float>::infinity();
+		wall_bvh_[at].query(bounds(r), [&] (glm::vec2 from, glm::vec2 swept)
+		{
+			first = std::min(first, phobos::cast(r, ray{ from, swept }));
+			return false;
+		});
+		return first;
+	}
+	}
+	return std::numeric_limits<float>::infinity();
+}
+
+phys::hit phys::raycast(glm::vec2 from, glm::vec2 to, entity ignore, std::uint32_t mask) const
+{
+	hit first{ 0, 1.0f };
+	const ray r{ from, to - from };
+	tree_.raycast(from, to, [&] (entity e, float max)
+	{
+		if (e == ignore || !(layer_of(e) & mask))
+			return max;
+		const auto t = cast(e, r);
+		if (t <= max)
+			first = { e, t };
+		return std::min(t, max);
+	});
+	return first;
 }
 
 int deriv::init()
@@ -253,11 +1035,13 @@ void deriv::fini()
 void deriv::update(float, float dt)
 {
 	for (const auto [x, xprime] : deriv_) {
-		auto &tx = *system.tfms.referential(x);
+		auto tx = system.tfms.referential(x);
 		// FIXME: not accurate for rotations?
-		const auto &txprime = *system.tfms.referential(xprime);
-		tx += dt * (txprime * tx);
+		const auto txprime = system.tfms.local(xprime);
+		const transform cur = tx;
+		tx = cur + dt * (txprime * cur);
 	}
+	system.tfms.propagate();
 }
 
 void deriv::deriv_from(entity x, entity xprime)
@@ -1,5 +1,6 @@
 #include "c++lib.hpp"
 #include "system.hpp"
+#include "archetype.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
 
@@ -447,20 +448,32 @@ void render::wall(entity e, full_wall_mesh const &mesh)
 	ctx[wall_mesh] = per_draw{ va, shader, tex, mesh.indices.size() };
 	add_component(e, system_id::render);
 	drawing_[wall_mesh].emplace_back(e);
-	const std::uint32_t idx = trail | drawing_[wall_mesh].size()-1 << type_shift;
+	const std::uint32_t idx = wall_mesh | drawing_[wall_mesh].size()-1 << type_shift;
 	reindex(e, system_id::render, idx);
 }
 
 void render::update(float now, float dt)
 {
-	for (size_t i = 0; i < trails.trailing_.size(); ++i) {
-		auto &data = trails.trailing_[i];
-		auto ref = system.tfms.world(data.ref);
-		data.buf[data.insert].base = ref.pos();
-		data.buf[data.insert].offs = ref.pos() + ref.y();
-		data.timestamp[data.insert] = glm::vec2{now, now};
-		data.insert = (data.insert+1) % TRAIL_MAX_SEGMENTS;
-	}
+	system.jobs.parallel_for(0, trails.trailing_.size(), 16, [&] (std::uint32_t begin, std::uint32_t end)
+	{
+		for (auto i = begin; i < end; ++i) {
+			auto &data = trails.trailing_[i];
+			auto ref = system.tfms.world(data.ref);
+			data.buf[data.insert].base = ref.pos();
+			data.buf[data.insert].offs = ref.pos() + ref.y();
+			data.timestamp[data.insert] = glm::vec2{now, now};
+			data.insert = (data.insert+1) % TRAIL_MAX_SEGMENTS;
+		}
+	});
+	for (auto &models : models_)
+		models.clear();
+	static view<system_id::tfms, system_id::render> drawn;
+	drawn.each([this] (entity e, std::uint32_t tfm_idx, std::uint32_t draw_idx)
+	{
+		const auto obj = draw_idx & type_mask;
+		if (obj != trail)
+			models_[obj].emplace_back(e, system.tfms.world_at(tfm_idx));
+	});
 	const auto camera_dim_i = system.input.win.dims();
 	const glm::vec2 camera_dim{static_cast<float>(camera_dim_i.x), static_cast<float>(camera_dim_i.y)};
 	const auto aspect_ratio = camera_dim.x / camera_dim.y;
@@ -478,13 +491,10 @@ void render::update(float now, float dt)
 		glBindVertexArray(this_draw.va);
 		glUniformMatrix3fv(glGetUniformLocation(this_draw.shader.id, "unif_view"), 1, GL_FALSE, glm::value_ptr(view));
 		glUniform1f(glGetUniformLocation(this_draw.shader.id, "world_zoom"), world_zoom);
-		if (obj != trail) for (const auto e : drawing_[obj]) {
-			auto this_entity = system.tfms.world(e);
+		if (obj != trail) for (auto &[e, this_entity] : models_[obj]) {
 			glUniformMatrix3x2fv(glGetUniformLocation(this_draw.shader.id, "unif_model"),
 					1, GL_FALSE, &this_entity[0][0]);
-			const auto begin = std::cbegin(system.phys.colliding);
-			const auto end   = std::cend  (system.phys.colliding);
-			const auto red_shift = std::find_if(begin, end, [=] (auto elem) { return elem.main == e | elem.other == e; }) != end? 0.3f: 0.0f;
+			const auto red_shift = system.phys.colliding_by.contains(e)? 0.3f: 0.0f;
 			// TODO: this should be a FSM hurt state to avoid searching every collision every time as well as handle the cooldown
 			// glUniform1f(glGetUniformLocation(this_draw.shader.id, "unif_red_shift"), red_shift);
 			if (obj == attack_cone) {
@@ -494,7 +504,7 @@ void render::update(float now, float dt)
 				glBindBuffer(GL_ARRAY_BUFFER, attack_cone_mesh_vb);
 				glBufferSubData(GL_ARRAY_BUFFER, sizeof(float[4]), sizeof slash_tail, &slash_tail);
 			} else if (obj == hp_bar) {
-				const auto parent = system.tfms.referential(e)->parent;
+				const auto parent = system.tfms.local(e).parent;
 				const auto hp = system.hp.living_[index(parent, system_id::hp)];
 				glUniform1f(glGetUniformLocation(this_draw.shader.id, "unif_fullness"), hp.current / hp.max);
 			}
@@ -0,0 +1,95 @@
+#include "c++lib.hpp"
+#include "schedule.hpp"
+#include "system.hpp"
+#include "command.hpp"
+#include <chrono>
+
+namespace phobos {
+
+static const char *const g_system_names[] = {
+	"jobs", "input", "tick", "tfms", "dispatch", "dispatch_timeout", "fsm",
+	"dispatch_death", "phys", "deriv", "hp", "render", "gl",
+};
+static_assert(std::size(g_system_names) == static_cast<size_t>(system_id::NUM));
+
+static double clock_ms()
+{
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+schedule &frame_schedule()
+{
+	static schedule sched;
+	return sched;
+}
+
+void schedule::build()
+{
+	slots_.clear();
+	graph_.clear();
+	stages_ = 0;
+	frame_ = 0;
+	const auto env = std::getenv("PHOBOS_SCHEDULE");
+	dump_every_ = env? std::strtoull(env, nullptr, 10): 0;
+	commands::init(system.jobs.size());
+
+	for (const auto &sys : systems::table) {
+		if (!sys.updates)
+			continue;
+		const std::uint32_t node = slots_.size();
+		slots_.push_back(slot{ sys.id, 0, 0.0f, 0.0f });
+		graph_.add([this, node]
+		{
+			auto &at = slots_[node];
+			at.begin_ms = clock_ms() - frame_start_;
+			// a node can run nested in another system's wait
+			const auto outer = commands::recording({ at.id, 0 });
+			systems::update(at.id, now_, dt_);
+			commands::recording(outer);
+			at.end_ms = clock_ms() - frame_start_;
+		}, sys.main_thread);
+	}
+	for (std::uint32_t j = 0; j < slots_.size(); ++j) {
+		const auto &later = systems::table[static_cast<size_t>(slots_[j].id)];
+		for (std::uint32_t i = 0; i < j; ++i) {
+			const auto &earlier = systems::table[static_cast<size_t>(slots_[i].id)];
+			const bool conflict = (earlier.writes & (later.reads | later.writes))
+			                    | (later.writes & earlier.reads);
+			if (!conflict)
+				continue;
+			graph_.depend(i, j);
+			slots_[j].stage = std::max(slots_[j].stage, slots_[i].stage+1);
+		}
+		stages_ = std::max(stages_, slots_[j].stage+1);
+	}
+	if (dump_every_)
+		dump();
+}
+
+void schedule::run(float now, float dt)
+{
+	now_ = now;
+	dt_ = dt;
+	frame_start_ = clock_ms();
+	system.jobs.run(graph_);
+	if (dump_every_ && ++frame_ % dump_every_ == 0)
+		dump();
+}
+
+void schedule::dump() const
+{
+	std::print("\n[SCHED] {} systems in {} stages\n", slots_.size(), stages_);
+	for (std::uint32_t stage = 0; stage < stages_; ++stage) {
+		std::print("[SCHED] stage {}:", stage);
+		for (const auto &at : slots_) {
+			if (at.stage != stage)
+				continue;
+			std::print(" {} [{:.3f}, {:.3f}]ms", g_system_names[static_cast<size_t>(at.id)], at.begin_ms, at.end_ms);
+		}
+		std::print("\n");
+	}
+}
+
+} // phobos
+
@@ -0,0 +1,168 @@
+#include "c++lib.hpp"
+#include "sdf.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace phobos {
+
+// cache file layout, followed by the values
+struct sdf_header
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t hash;
+	float origin[2];
+	float cell;
+	std::uint32_t width;
+	std::uint32_t height;
+};
+
+static constexpr std::uint32_t sdf_version = 1;
+
+// fnv-1a
+static std::uint64_t hash_bytes(std::uint64_t h, void const *data, size_t size)
+{
+	const auto bytes = static_cast<unsigned char const*>(data);
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ bytes[i]) * 0x100000001b3ull;
+	return h;
+}
+
+void distance_field::bake(edge_bvh const &edges, std::vector<glm::vec2> const &loop,
+		float cell, float margin, std::string_view cache_dir)
+{
+	assert(cell > 0.0f && !loop.empty());
+	auto hash = hash_bytes(0xcbf29ce484222325ull, loop.data(), loop.size() * sizeof loop[0]);
+	hash = hash_bytes(hash, &cell, sizeof cell);
+	hash = hash_bytes(hash, &margin, sizeof margin);
+	std::string path;
+	if (!cache_dir.empty()) {
+		char name[32];
+		std::snprintf(name, sizeof name, "/wall_%016llx.sdf", static_cast<unsigned long long>(hash));
+		path = std::string{cache_dir} + name;
+		if (load(path, hash))
+			return;
+	}
+
+	glm::vec2 lo = loop[0], hi = loop[0];
+	for (const auto &p : loop) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	const glm::vec2 grow{ margin, margin };
+	origin_ = lo - grow;
+	cell_ = cell;
+	const auto extent = hi + grow - origin_;
+	width_ = static_cast<std::uint32_t>(std::ceil(extent.x / cell)) + 1;
+	height_ = static_cast<std::uint32_t>(std::ceil(extent.y / cell)) + 1;
+	values_.resize(size_t{width_} * height_);
+	for (std::uint32_t y = 0; y < height_; ++y) {
+		for (std::uint32_t x = 0; x < width_; ++x) {
+			const auto p = origin_ + cell * glm::vec2{ static_cast<float>(x), static_cast<float>(y) };
+			const auto d = std::sqrt(edges.nearest2(p));
+			values_[size_t{y} * width_ + x] = edges.inside(p)? -d: d;
+		}
+	}
+	if (!path.empty())
+		save(path, hash);
+}
+
+bool distance_field::load(std::string const &path, std::uint64_t hash)
+{
+	const auto file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	sdf_header h;
+	bool ok = std::fread(&h, sizeof h, 1, file) == 1
+	       && !std::memcmp(h.magic, "PSDF", 4) && h.version == sdf_version && h.hash == hash;
+	if (ok) {
+		values_.resize(size_t{h.width} * h.height);
+		ok = std::fread(values_.data(), sizeof values_[0], values_.size(), file) == values_.size();
+	}
+	std::fclose(file);
+	if (!ok) {
+		std::print("[PHYS] Ignoring stale distance field {}\n", path);
+		values_.clear();
+		return false;
+	}
+	origin_ = { h.origin[0], h.origin[1] };
+	cell_ = h.cell;
+	width_ = h.width;
+	height_ = h.height;
+	return true;
+}
+
+void distance_field::save(std::string const &path, std::uint64_t hash) const
+{
+	const auto file = std::fopen(path.c_str(), "wb");
+	if (!file) {
+		std::print("[PHYS] Failed to cache distance field to {}\n", path);
+		return;
+	}
+	const sdf_header h{
+		{ 'P', 'S', 'D', 'F' }, sdf_version, hash,
+		{ origin_.x, origin_.y }, cell_, width_, height_,
+	};
+	std::fwrite(&h, sizeof h, 1, file);
+	std::fwrite(values_.data(), sizeof values_[0], values_.size(), file);
+	std::fclose(file);
+}
+
+bool distance_field::empty() const
+{
+	return values_.empty();
+}
+
+bool distance_field::covers(glm::vec2 p) const
+{
+	const auto g = (p - origin_) / cell_;
+	return g.x >= 0.0f && g.y >= 0.0f && g.x <= width_-1 && g.y <= height_-1;
+}
+
+float distance_field::slack() const
+{
+	// worst case is the middle of a cell, half its diagonal away
+	// from every sample
+	return cell_ * 0.7072f;
+}
+
+void distance_field::locate(glm::vec2 p, std::uint32_t *x, std::uint32_t *y, glm::vec2 *f) const
+{
+	assert(covers(p));
+	const auto g = (p - origin_) / cell_;
+	*x = std::min(static_cast<std::uint32_t>(g.x), width_-2);
+	*y = std::min(static_cast<std::uint32_t>(g.y), height_-2);
+	*f = g - glm::vec2{ static_cast<float>(*x), static_cast<float>(*y) };
+}
+
+float distance_field::distance(glm::vec2 p) const
+{
+	std::uint32_t x, y;
+	glm::vec2 f;
+	locate(p, &x, &y, &f);
+	const auto row = &values_[size_t{y} * width_ + x];
+	const auto bottom = row[0] + (row[1] - row[0]) * f.x;
+	const auto top = row[width_] + (row[width_+1] - row[width_]) * f.x;
+	return bottom + (top - bottom) * f.y;
+}
+
+distance_field::sample distance_field::at(glm::vec2 p) const
+{
+	std::uint32_t x, y;
+	glm::vec2 f;
+	locate(p, &x, &y, &f);
+	const auto row = &values_[size_t{y} * width_ + x];
+	const auto d00 = row[0], d10 = row[1], d01 = row[width_], d11 = row[width_+1];
+	const auto bottom = d00 + (d10 - d00) * f.x;
+	const auto top = d01 + (d11 - d01) * f.x;
+	return {
+		bottom + (top - bottom) * f.y,
+		glm::vec2{
+			(d10 - d00) * (1.0f - f.y) + (d11 - d01) * f.y,
+			top - bottom,
+		} / cell_,
+	};
+}
+
+} // phobos
@@ -0,0 +1,44 @@
+#include "c++lib.hpp"
+#include "sparse.hpp"
+
+namespace phobos {
+
+void sparse_index::insert(std::uint32_t key, std::uint32_t value)
+{
+	const auto page = key >> page_shift;
+	if (page >= pages_.size())
+		pages_.resize(page+1);
+	if (!pages_[page]) {
+		pages_[page] = std::make_unique<std::uint32_t[]>(page_size);
+		std::fill_n(pages_[page].get(), page_size, none);
+	}
+	auto &at = pages_[page][key & page_mask];
+	assert(at == none);
+	at = keys_.size();
+	keys_.push_back(key);
+	values_.push_back(value);
+}
+
+void sparse_index::erase(std::uint32_t key)
+{
+	const auto at = slot(key);
+	assert(at && *at != none);
+	const std::uint32_t removed_idx = *at;
+	const std::uint32_t swapped_idx = keys_.size()-1;
+	keys_  [removed_idx] = keys_  [swapped_idx];
+	values_[removed_idx] = values_[swapped_idx];
+	*slot(keys_[removed_idx]) = removed_idx;
+	*at = none;
+	keys_.pop_back();
+	values_.pop_back();
+}
+
+void sparse_index::clear()
+{
+	pages_.clear();
+	keys_.clear();
+	values_.clear();
+}
+
+} // phobos
+
@@ -0,0 +1,129 @@
+#include "c++lib.hpp"
+#include "sweep.hpp"
+
+namespace phobos {
+
+void sweep_and_prune::set(entity key, aabb const &box, std::uint32_t ref)
+{
+	const auto idx = entity_index(key);
+	if (slots_.contains(idx)) {
+		auto &obj = objects_[slots_.at(idx)];
+		obj.box = box;
+		obj.ref = ref;
+		return;
+	}
+	std::uint32_t slot;
+	if (!free_.empty()) {
+		slot = free_.back();
+		free_.pop_back();
+	} else {
+		slot = objects_.size();
+		objects_.emplace_back();
+	}
+	objects_[slot] = object{ box, key, ref };
+	slots_.insert(idx, slot);
+	// sorting them in from the end would cross everything
+	born_.push_back(slot);
+}
+
+void sweep_and_prune::remove(entity key)
+{
+	const auto idx = entity_index(key);
+	if (!slots_.contains(idx))
+		return;
+	const auto slot = slots_.at(idx);
+	slots_.erase(idx);
+	// purged by the next update, all at once
+	objects_[slot].key = 0;
+	dead_.push_back(slot);
+}
+
+void sweep_and_prune::purge()
+{
+	const auto dead = [this] (std::uint32_t slot) { return !objects_[slot].key; };
+	std::erase_if(endpoints_, [&] (endpoint const &e) { return dead(e.end >> 1); });
+	std::erase_if(born_, dead);
+	std::erase_if(overlapping_, [&] (std::uint64_t key) { return dead(key >> 32) || dead(key & 0xffffffff); });
+	free_.insert(std::end(free_), std::begin(dead_), std::end(dead_));
+	dead_.clear();
+}
+
+void sweep_and_prune::begin_overlap(std::uint32_t a, std::uint32_t b)
+{
+	overlapping_.insert(pair_key(a, b));
+}
+
+void sweep_and_prune::end_overlap(std::uint32_t a, std::uint32_t b)
+{
+	overlapping_.erase(pair_key(a, b));
+}
+
+// merged in place then one sweep for the overlaps involving
+// a new box, active_ holds the boxes open at the current endpoint
+void sweep_and_prune::insert_born()
+{
+	const auto old = endpoints_.size();
+	for (const auto slot : born_) {
+		const auto &box = objects_[slot].box;
+		endpoints_.push_back(endpoint{ box.min.x, slot << 1 });
+		endpoints_.push_back(endpoint{ box.max.x, slot << 1 | 1 });
+	}
+	const auto mid = std::begin(endpoints_) + old;
+	std::sort(mid, std::end(endpoints_), before);
+	std::inplace_merge(std::begin(endpoints_), mid, std::end(endpoints_), before);
+
+	static std::vector<std::uint8_t> born;
+	born.assign(objects_.size(), 0);
+	for (const auto slot : born_)
+		born[slot] = 1;
+	static std::vector<std::uint32_t> active, active_born;
+	active.clear();
+	active_born.clear();
+	for (const auto &e : endpoints_) {
+		const auto slot = e.end >> 1;
+		auto &open = born[slot]? active_born: active;
+		if (e.end & 1) {
+			*std::find(std::begin(open), std::end(open), slot) = open.back();
+			open.pop_back();
+			continue;
+		}
+		for (const auto other : active_born)
+			begin_overlap(slot, other);
+		if (born[slot])
+			for (const auto other : active)
+				begin_overlap(slot, other);
+		open.push_back(slot);
+	}
+	born_.clear();
+}
+
+void sweep_and_prune::update()
+{
+	if (!dead_.empty())
+		purge();
+	for (auto &e : endpoints_) {
+		const auto &box = objects_[e.end >> 1].box;
+		e.at = e.end & 1? box.max.x: box.min.x;
+	}
+	// a min and a max of two boxes can't both be the wrong
+	// way round, so flipping one of them is always what starts
+	// or ends the overlap
+	for (size_t i = 1; i < endpoints_.size(); ++i) {
+		const auto cur = endpoints_[i];
+		auto at = i;
+		for (; at > 0 && before(cur, endpoints_[at-1]); --at) {
+			const auto prev = endpoints_[at-1];
+			const bool cur_max = cur.end & 1, prev_max = prev.end & 1;
+			if (!cur_max && prev_max)
+				begin_overlap(cur.end >> 1, prev.end >> 1);
+			else if (cur_max && !prev_max)
+				end_overlap(cur.end >> 1, prev.end >> 1);
+			endpoints_[at] = prev;
+		}
+		endpoints_[at] = cur;
+	}
+	if (!born_.empty())
+		insert_born();
+}
+
+} // phobos
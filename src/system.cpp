@@ -1,68 +1,73 @@
 #include "system.hpp"
+#include "sparse.hpp"
+#include "archetype.hpp"
+#include "schedule.hpp"
+#include "command.hpp"
 
 namespace phobos {
 // single definition
 global_systems system;
-extern std::unordered_map<entity, std::uint32_t> g_entity_mapping[static_cast<size_t>(system_id::NUM)];
+extern sparse_index g_entity_mapping[static_cast<size_t>(system_id::NUM)];
+extern paged_array<signature, entity_index_bits> g_signature;
 
 int init()
 {
-	system_id failure_point = system_id::NUM;
-#define X(name) if (system.name.init() != 0) { \
-			failure_point = system_id::name; \
-			goto end; \
-		}
-	PHOBOS_SYSTEMS(X)
-#undef X
-end:
-	return failure_point != system_id::NUM? -static_cast<int>(failure_point)-1: 0;
+	const auto status = systems::init();
+	if (status == 0)
+		frame_schedule().build();
+	return status;
 }
 
 void fini()
 {
-#define X(name) system.name.fini();
-	PHOBOS_SYSTEMS(X)
-#undef X
+	systems::fini();
 }
 
 void update(float now, float dt)
 {
-#define X(name) system.name.update(now, dt);
-	PHOBOS_SYSTEMS(X)
-#undef X
+	frame_schedule().run(now, dt);
+	commands::flush();
 	update(); // entity index could be a system too
 }
 
 std::uint32_t index(entity e, system_id sys)
 {
-	auto addr = g_entity_mapping[static_cast<size_t>(sys)].find(e);
-	assert(addr != g_entity_mapping[static_cast<size_t>(sys)].end());
-	return addr->second;
+	assert(alive(e));
+	return g_entity_mapping[static_cast<size_t>(sys)].at(entity_index(e));
 }
 
 void reindex(entity e, system_id sys, std::uint32_t idx)
 {
-	auto addr = g_entity_mapping[static_cast<size_t>(sys)].find(e);
-	assert(addr != g_entity_mapping[static_cast<size_t>(sys)].end());
-	addr->second = idx;
+	assert(alive(e));
+	g_entity_mapping[static_cast<size_t>(sys)].at(entity_index(e)) = idx;
+	archetypes().set(e, sys, idx);
 }
 
 void add_component(entity e, system_id sys)
 {
-	auto [addr, ins] = g_entity_mapping[static_cast<size_t>(sys)].emplace(e, 0);
-	assert(ins);
+	assert(alive(e));
+	g_entity_mapping[static_cast<size_t>(sys)].insert(entity_index(e), 0);
+	g_signature[entity_index(e)].set(static_cast<size_t>(sys));
+	archetypes().add(e, sys);
 }
 
 void del_component(entity e, system_id sys)
 {
-	auto addr = g_entity_mapping[static_cast<size_t>(sys)].find(e);
-	assert(addr != g_entity_mapping[static_cast<size_t>(sys)].end());
-	g_entity_mapping[static_cast<size_t>(sys)].erase(addr);
+	assert(alive(e));
+	g_entity_mapping[static_cast<size_t>(sys)].erase(entity_index(e));
+	g_signature[entity_index(e)].reset(static_cast<size_t>(sys));
+	archetypes().del(e, sys);
 }
 
 bool has_component(entity e, system_id sys)
 {
-	return g_entity_mapping[static_cast<size_t>(sys)].contains(e);
+	return components(e).test(static_cast<size_t>(sys));
+}
+
+signature components(entity e)
+{
+	// stale handles own nothing, even if their index was recycled
+	return alive(e)? g_signature[entity_index(e)]: signature{};
 }
 
 } // phobos
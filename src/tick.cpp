@@ -1,5 +1,6 @@
 #include "c++lib.hpp"
 #include "system.hpp"
+#include "command.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 
@@ -29,8 +30,10 @@ void tick::update(float, float dt)
 			timeout.emplace_back(data.id);
 		}
 	}
+	// dropped at the flush, before anyone can wait() again
+	auto &cmd = commands::local();
 	for (auto e : timeout) {
-		remove(e);
+		cmd.remove(e, system_id::tick);
 	}
 }
 
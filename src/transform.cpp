@@ -1,14 +1,103 @@
 #include "c++lib.hpp"
 #include "system.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace phobos {
 
 glm::vec2 &transform::pos() { return (*this)[2]; }
 glm::vec2 &transform::  x() { return (*this)[0]; }
 glm::vec2 &transform::  y() { return (*this)[1]; }
+glm::vec2 const &transform::pos() const { return (*this)[2]; }
+glm::vec2 const &transform::  x() const { return (*this)[0]; }
+glm::vec2 const &transform::  y() const { return (*this)[1]; }
+
+using compose_fn = void (*)(tfms::lanes const &local, tfms::lanes &world,
+		glm::vec2 px, glm::vec2 py, glm::vec2 pp, std::uint32_t begin, std::uint32_t end);
+
+// world = parent * local over [begin, end), every entry of the
+// run has the same parent (px, py, pp)
+static void compose_scalar(tfms::lanes const &l, tfms::lanes &w,
+		glm::vec2 px, glm::vec2 py, glm::vec2 pp, std::uint32_t begin, std::uint32_t end)
+{
+	for (auto at = begin; at < end; ++at) {
+		w.x  [at] = px * l.x  [at].x + py * l.x  [at].y;
+		w.y  [at] = px * l.y  [at].x + py * l.y  [at].y;
+		w.pos[at] = px * l.pos[at].x + py * l.pos[at].y + pp;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 4 vec2 per register, moveldup/movehdup broadcast the coordinate
+// to multiply by. no fma so the result is the same as the scalar path
+__attribute__((target("avx")))
+static __m256 apply4(__m256 px, __m256 py, __m256 v)
+{
+	return _mm256_add_ps(_mm256_mul_ps(px, _mm256_moveldup_ps(v)), _mm256_mul_ps(py, _mm256_movehdup_ps(v)));
+}
+
+__attribute__((target("avx")))
+static void compose_avx(tfms::lanes const &l, tfms::lanes &w,
+		glm::vec2 px, glm::vec2 py, glm::vec2 pp, std::uint32_t begin, std::uint32_t end)
+{
+	// most runs are a few leaves, not worth the ymm state
+	if (end - begin < 8)
+		return compose_scalar(l, w, px, py, pp, begin, end);
+	const auto vx = _mm256_setr_ps(px.x, px.y, px.x, px.y, px.x, px.y, px.x, px.y);
+	const auto vy = _mm256_setr_ps(py.x, py.y, py.x, py.y, py.x, py.y, py.x, py.y);
+	const auto vp = _mm256_setr_ps(pp.x, pp.y, pp.x, pp.y, pp.x, pp.y, pp.x, pp.y);
+	auto at = begin;
+	for (; at + 8 <= end; at += 8) {
+		for (std::uint32_t half = 0; half < 8; half += 4) {
+			const auto i = at + half;
+			_mm256_storeu_ps(&w.x  [i].x, apply4(vx, vy, _mm256_loadu_ps(&l.x  [i].x)));
+			_mm256_storeu_ps(&w.y  [i].x, apply4(vx, vy, _mm256_loadu_ps(&l.y  [i].x)));
+			_mm256_storeu_ps(&w.pos[i].x, _mm256_add_ps(apply4(vx, vy, _mm256_loadu_ps(&l.pos[i].x)), vp));
+		}
+	}
+	// the scalar tail is legacy sse, avoid the transition penalty
+	_mm256_zeroupper();
+	compose_scalar(l, w, px, py, pp, at, end);
+}
+
+__attribute__((target("sse3")))
+static __m128 apply2(__m128 px, __m128 py, __m128 v)
+{
+	return _mm_add_ps(_mm_mul_ps(px, _mm_moveldup_ps(v)), _mm_mul_ps(py, _mm_movehdup_ps(v)));
+}
+
+__attribute__((target("sse3")))
+static void compose_sse3(tfms::lanes const &l, tfms::lanes &w,
+		glm::vec2 px, glm::vec2 py, glm::vec2 pp, std::uint32_t begin, std::uint32_t end)
+{
+	const auto vx = _mm_setr_ps(px.x, px.y, px.x, px.y);
+	const auto vy = _mm_setr_ps(py.x, py.y, py.x, py.y);
+	const auto vp = _mm_setr_ps(pp.x, pp.y, pp.x, pp.y);
+	auto at = begin;
+	for (; at + 2 <= end; at += 2) {
+		_mm_storeu_ps(&w.x  [at].x, apply2(vx, vy, _mm_loadu_ps(&l.x  [at].x)));
+		_mm_storeu_ps(&w.y  [at].x, apply2(vx, vy, _mm_loadu_ps(&l.y  [at].x)));
+		_mm_storeu_ps(&w.pos[at].x, _mm_add_ps(apply2(vx, vy, _mm_loadu_ps(&l.pos[at].x)), vp));
+	}
+	compose_scalar(l, w, px, py, pp, at, end);
+}
+#endif
+
+static compose_fn g_compose = compose_scalar;
 
 int tfms::init()
 {
+	// PHOBOS_SIMD=0 forces the scalar path
+	const auto env = std::getenv("PHOBOS_SIMD");
+	if (env && std::atoi(env) == 0)
+		return 0;
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("avx"))
+		g_compose = compose_avx;
+	else if (__builtin_cpu_supports("sse3"))
+		g_compose = compose_sse3;
+#endif
 	return 0;
 }
 
@@ -18,6 +107,43 @@ void tfms::fini()
 
 void tfms::update(float, float)
 {
+	propagate();
+}
+
+template <typename F>
+void tfms::columns(F &&fn)
+{
+	fn(local_.x);
+	fn(local_.y);
+	fn(local_.pos);
+	fn(world_.x);
+	fn(world_.y);
+	fn(world_.pos);
+	fn(parent_);
+	fn(id_);
+	fn(size_);
+	fn(dirty_);
+	fn(moved_);
+}
+
+std::uint32_t tfms::parent_of(std::uint32_t idx) const
+{
+	const auto p = parent_[idx];
+	return p && has_component(p, system_id::tfms)? index(p, system_id::tfms): none;
+}
+
+// ancestors come first, so their index isn't touched by a shift
+// of what follows idx
+void tfms::resize_ancestors(std::uint32_t idx, std::int32_t by)
+{
+	for (auto at = parent_of(idx); at != none; at = parent_of(at))
+		size_[at] += by;
+}
+
+void tfms::reindex_from(std::uint32_t idx)
+{
+	for (auto at = idx; at < id_.size(); ++at)
+		reindex(id_[at], system_id::tfms, at);
 }
 
 void tfms::transformable(entity e, float scale, glm::vec2 offset, entity parent)
@@ -35,35 +161,197 @@ void tfms::transformable(entity e, float scale, glm::vec2 offset, entity parent)
 
 void tfms::transformable(entity e, transform tfm)
 {
-	tfm.id = e;
-	data.emplace_back(tfm);
+	const bool child = tfm.parent && has_component(tfm.parent, system_id::tfms);
+	// always appended, that is still depth first for a root or a
+	// child whose parent's run ends here, anything else is put
+	// back in order once by the next propagate()
+	const std::uint32_t at = id_.size();
+	const auto parent = child? index(tfm.parent, system_id::tfms): none;
+	const bool in_order = !child || (ordered_ && parent + size_[parent] == at);
+	columns([] (auto &column) { column.emplace_back(); });
+	local_.x  [at] = tfm.x  ();
+	local_.y  [at] = tfm.y  ();
+	local_.pos[at] = tfm.pos();
+	parent_[at] = child? tfm.parent: 0;
+	id_[at] = e;
+	size_[at] = 1;
+	dirty_[at] = 1;
+	if (in_order)
+		resize_ancestors(at, +1);
+	else
+		ordered_ = false;
 	add_component(e, system_id::tfms);
-	reindex(e, system_id::tfms, data.size()-1);
+	reindex(e, system_id::tfms, at);
+}
+
+// one pass over everything however many entries came out of
+// order since the last one: children are linked by parent in
+// index order, walked depth first and the columns gathered
+void tfms::restore_order()
+{
+	if (ordered_)
+		return;
+	ordered_ = true;
+	const std::uint32_t n = id_.size();
+	// first child of each entry, the roots under n
+	static std::vector<std::uint32_t> first, next, order, up;
+	first.assign(n+1, none);
+	next.assign(n, none);
+	for (auto at = n; at-- > 0;) {
+		const auto parent = parent_of(at);
+		const auto slot = parent == none? n: parent;
+		next[at] = first[slot];
+		first[slot] = at;
+	}
+	order.clear();
+	up.clear();
+	for (auto at = first[n]; at != none;) {
+		order.push_back(at);
+		if (first[at] != none) {
+			up.push_back(at);
+			at = first[at];
+			continue;
+		}
+		while (next[at] == none && !up.empty()) {
+			at = up.back();
+			up.pop_back();
+		}
+		at = next[at];
+	}
+	columns([] (auto &column) {
+		const auto old = column;
+		for (std::uint32_t k = 0; k < order.size(); ++k)
+			column[k] = old[order[k]];
+	});
+	reindex_from(0);
+	// children come after their parent
+	std::ranges::fill(size_, 1);
+	for (auto at = n; at-- > 0;)
+		if (const auto parent = parent_of(at); parent != none)
+			size_[parent] += size_[at];
 }
 
 void tfms::remove(entity e)
 {
-	const std::uint32_t idx = index(e, system_id::tfms);
-	const std::uint32_t swapped_idx = data.size()-1;
-	data[idx] = data[swapped_idx];
-	reindex(data[idx].id, system_id::tfms, idx);
+	restore_order();
+	const std::uint32_t at = index(e, system_id::tfms);
+	const auto n = size_[at];
+	// the rest of the subtree dies with it, their transforms go now
+	for (auto i = at+1; i < at+n; ++i) {
+		despawn(id_[i]);
+		del_component(id_[i], system_id::tfms);
+	}
+	resize_ancestors(at, -static_cast<std::int32_t>(n));
 	del_component(e, system_id::tfms);
-	data.pop_back();
+	columns([=] (auto &column) { column.erase(std::begin(column) + at, std::begin(column) + at+n); });
+	reindex_from(at);
+}
+
+transform_ref::transform_ref(tfms *store, std::uint32_t idx):
+	store_(store), idx_(idx)
+{
+	// one byte per entry, so rows of a par_each can mark their own
+	store_->dirty_[idx_] = 1;
+}
+
+glm::vec2 &transform_ref::pos() { return store_->local_.pos[idx_]; }
+glm::vec2 &transform_ref::  x() { return store_->local_.x  [idx_]; }
+glm::vec2 &transform_ref::  y() { return store_->local_.y  [idx_]; }
+
+transform_ref::operator transform() const
+{
+	const auto &l = store_->local_;
+	return transform{{ l.x[idx_], l.y[idx_], l.pos[idx_] }, store_->parent_[idx_], store_->id_[idx_]};
+}
+
+transform_ref &transform_ref::operator=(glm::mat3x2 const &m)
+{
+	x() = m[0];
+	y() = m[1];
+	pos() = m[2];
+	return *this;
+}
+
+transform_ref tfms::referential(entity e)
+{
+	return modify(index(e, system_id::tfms));
+}
+
+transform_ref tfms::modify(std::uint32_t idx)
+{
+	return transform_ref{this, idx};
+}
+
+transform tfms::local(entity e) const
+{
+	const auto idx = index(e, system_id::tfms);
+	return transform{{ local_.x[idx], local_.y[idx], local_.pos[idx] }, parent_[idx], id_[idx]};
+}
+
+transform tfms::world(entity e) const
+{
+	return world_at(index(e, system_id::tfms));
+}
+
+transform tfms::world_at(std::uint32_t idx) const
+{
+	assert(!dirty_[idx]);
+	return transform{{ world_.x[idx], world_.y[idx], world_.pos[idx] }, parent_[idx], id_[idx]};
 }
 
-transform *tfms::referential(entity e)
+void tfms::compose(std::uint32_t parent, std::uint32_t begin, std::uint32_t end)
 {
-	auto at = index(e, system_id::tfms);
-	return &data[at];
+	if (parent == none)
+		g_compose(local_, world_, {1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}, begin, end);
+	else
+		g_compose(local_, world_, world_.x[parent], world_.y[parent], world_.pos[parent], begin, end);
 }
 
-transform tfms::world(entity e)
+void tfms::propagate()
 {
-	auto *at = referential(e);
-	if (at->parent) {
-		return world(at->parent) * *at;
-	} else {
-		return *at;
+	restore_order();
+	const std::uint32_t n = id_.size();
+	// ancestors of the current entry
+	static std::vector<std::uint32_t> up;
+	up.clear();
+	for (std::uint32_t at = 0; at < n;) {
+		while (!up.empty() && at >= up.back() + size_[up.back()])
+			up.pop_back();
+		const auto parent = up.empty()? none: up.back();
+		const std::uint8_t parent_moved = parent != none && moved_[parent];
+		if (size_[at] > 1) {
+			moved_[at] = dirty_[at] | parent_moved;
+			dirty_[at] = 0;
+			if (moved_[at])
+				compose(parent, at, at+1);
+			up.push_back(at);
+			++at;
+			continue;
+		}
+		// leaves under the same parent are independent, the
+		// dirty ones go by runs of 8 or the whole lot if the
+		// parent moved, recomputing one that didn't move is harmless
+		const auto end = parent == none? n: parent + size_[parent];
+		auto last = at;
+		while (last < end && size_[last] == 1)
+			++last;
+		auto run = none;
+		for (auto block = at; block < last; block = std::min(block+8, last)) {
+			std::uint8_t any = parent_moved;
+			for (auto i = block; i < std::min(block+8, last); ++i) {
+				any |= dirty_[i];
+				dirty_[i] = 0;
+			}
+			if (any && run == none) {
+				run = block;
+			} else if (!any && run != none) {
+				compose(parent, run, block);
+				run = none;
+			}
+		}
+		if (run != none)
+			compose(parent, run, last);
+		at = last;
 	}
 }
 
@@ -0,0 +1,137 @@
+#include "c++lib.hpp"
+#include "tree.hpp"
+
+namespace phobos {
+
+aabb merge(aabb const &a, aabb const &b)
+{
+	return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+// 2d stand-in for the surface area heuristic
+static float perimeter(aabb const &box)
+{
+	const auto d = box.max - box.min;
+	return 2.0f * (d.x + d.y);
+}
+
+static bool contains(aabb const &outer, aabb const &inner)
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y
+	    && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+std::uint32_t aabb_tree::alloc()
+{
+	if (free_ == null) {
+		nodes_.emplace_back();
+		return nodes_.size()-1;
+	}
+	const auto n = free_;
+	free_ = nodes_[n].parent;
+	return n;
+}
+
+void aabb_tree::release(std::uint32_t n)
+{
+	nodes_[n].parent = free_;
+	free_ = n;
+}
+
+std::uint32_t aabb_tree::insert(aabb const &box, entity e)
+{
+	const auto leaf = alloc();
+	const glm::vec2 fat{ margin, margin };
+	nodes_[leaf] = node{ { box.min - fat, box.max + fat }, null, null, null, e };
+	insert_leaf(leaf);
+	return leaf;
+}
+
+void aabb_tree::remove(std::uint32_t leaf)
+{
+	remove_leaf(leaf);
+	release(leaf);
+}
+
+bool aabb_tree::move(std::uint32_t leaf, aabb const &box)
+{
+	if (contains(nodes_[leaf].box, box))
+		return false;
+	remove_leaf(leaf);
+	const glm::vec2 fat{ margin, margin };
+	nodes_[leaf].box = { box.min - fat, box.max + fat };
+	insert_leaf(leaf);
+	return true;
+}
+
+void aabb_tree::refit(std::uint32_t from)
+{
+	for (auto at = from; at != null; at = nodes_[at].parent)
+		nodes_[at].box = merge(nodes_[nodes_[at].left].box, nodes_[nodes_[at].right].box);
+}
+
+void aabb_tree::insert_leaf(std::uint32_t leaf)
+{
+	if (root_ == null) {
+		root_ = leaf;
+		nodes_[leaf].parent = null;
+		return;
+	}
+	// walk down to the sibling that grows the tree the least
+	const auto box = nodes_[leaf].box;
+	auto sibling = root_;
+	while (nodes_[sibling].left != null) {
+		const auto &n = nodes_[sibling];
+		const auto combined = perimeter(merge(n.box, box));
+		// a new parent here, or the growth pushed down into a child
+		const auto here = 2.0f * combined;
+		const auto inherited = 2.0f * (combined - perimeter(n.box));
+		const auto descend = [&] (std::uint32_t child)
+		{
+			const auto &c = nodes_[child];
+			const auto grown = perimeter(merge(c.box, box));
+			return inherited + (c.left == null? grown: grown - perimeter(c.box));
+		};
+		const auto left = descend(n.left);
+		const auto right = descend(n.right);
+		if (here < left && here < right)
+			break;
+		sibling = left < right? n.left: n.right;
+	}
+
+	const auto old_parent = nodes_[sibling].parent;
+	const auto parent = alloc();
+	nodes_[parent] = node{ merge(nodes_[sibling].box, box), old_parent, sibling, leaf, 0 };
+	nodes_[sibling].parent = parent;
+	nodes_[leaf].parent = parent;
+	if (old_parent == null) {
+		root_ = parent;
+	} else {
+		auto &p = nodes_[old_parent];
+		(p.left == sibling? p.left: p.right) = parent;
+		refit(old_parent);
+	}
+}
+
+void aabb_tree::remove_leaf(std::uint32_t leaf)
+{
+	if (leaf == root_) {
+		root_ = null;
+		return;
+	}
+	// the sibling takes the parent's place
+	const auto parent = nodes_[leaf].parent;
+	const auto grand = nodes_[parent].parent;
+	const auto sibling = nodes_[parent].left == leaf? nodes_[parent].right: nodes_[parent].left;
+	nodes_[sibling].parent = grand;
+	if (grand == null) {
+		root_ = sibling;
+	} else {
+		auto &g = nodes_[grand];
+		(g.left == parent? g.left: g.right) = sibling;
+		refit(grand);
+	}
+	release(parent);
+}
+
+} // phobos